@@ -0,0 +1,467 @@
+// End-to-end throughput of the batch converter on a synthetic mod tree.
+//
+//   arma3-paa-bench [--files N] [--min-side N] [--max-side N] [--exponent X]
+//                   [--seed N] [--corpus <dir>] [--threads N] [--io <backend>]
+//                   [--quality <tier>] [--pin | --compare-pinning] [--json <file>]
+//                   [--min-mps X] [--verbose]
+//
+// The corpus is a reproducible power-law mix of square and 2:1 textures from
+// --min-side to --max-side (P(side) ~ side^-exponent), each opaque, 1-bit or
+// full alpha with flat or noisy content. It is generated from the seed with a
+// portable sampler, so the same arguments give the same files everywhere.
+// --corpus keeps it in <dir> and reuses it while the arguments match.
+//
+// The files then go through BatchConverter exactly as `--batch` would run
+// them. Reported: files/s, megapixels/s, peak RSS of the conversion and the
+// per-stage time split. With --min-mps the exit code is 1 when throughput
+// drops below X megapixels/s, which is how the CTest entry catches
+// regressions. --pin runs the workers pinned to cores across NUMA nodes;
+// --compare-pinning converts the corpus unpinned and then pinned and
+// reports both, with the files each node converted.
+
+#include "alloc_stats.h"
+#include "batch_converter.h"
+#include "cpu_topology.h"
+#include "stage_timer.h"
+
+#include <png.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace arma3;
+
+namespace {
+
+struct CorpusSettings {
+    size_t files = 64;
+    uint32_t minSide = 64;
+    uint32_t maxSide = 8192;
+    double exponent = 0.5;
+    uint64_t seed = 42;
+
+    std::string describe() const {
+        std::ostringstream ss;
+        ss << "v1 files=" << files << " min=" << minSide << " max=" << maxSide
+           << " exponent=" << exponent << " seed=" << seed;
+        return ss.str();
+    }
+};
+
+enum class AlphaVariant { Opaque, Binary, Full };
+
+struct TextureSpec {
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+    AlphaVariant alpha;
+    bool noisy;
+    uint32_t contentSeed;
+};
+
+const char* variantName(AlphaVariant alpha) {
+    switch (alpha) {
+        case AlphaVariant::Opaque: return "opaque";
+        case AlphaVariant::Binary: return "binary";
+        default: return "alpha";
+    }
+}
+
+// std::*_distribution output differs between standard libraries; raw
+// mt19937_64 output does not
+double uniform(std::mt19937_64& rng) {
+    return static_cast<double>(rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::vector<TextureSpec> planCorpus(const CorpusSettings& settings) {
+    std::vector<uint32_t> sides;
+    std::vector<double> weights;
+    double total = 0.0;
+    for (uint32_t side = settings.minSide; side <= settings.maxSide; side *= 2) {
+        sides.push_back(side);
+        weights.push_back(std::pow(static_cast<double>(side), -settings.exponent));
+        total += weights.back();
+    }
+
+    std::mt19937_64 rng(settings.seed);
+    std::vector<TextureSpec> specs;
+    for (size_t i = 0; i < settings.files; i++) {
+        double pick = uniform(rng) * total;
+        size_t k = 0;
+        while (k + 1 < sides.size() && pick >= weights[k]) {
+            pick -= weights[k];
+            k++;
+        }
+
+        TextureSpec spec;
+        spec.width = spec.height = sides[k];
+        double aspect = uniform(rng);
+        if (aspect < 0.125 && sides[k] > settings.minSide) spec.height /= 2;
+        else if (aspect < 0.25 && sides[k] > settings.minSide) spec.width /= 2;
+
+        double alpha = uniform(rng);
+        spec.alpha = alpha < 0.5 ? AlphaVariant::Opaque : alpha < 0.7 ? AlphaVariant::Binary : AlphaVariant::Full;
+        spec.noisy = uniform(rng) >= 0.3;
+        spec.contentSeed = static_cast<uint32_t>(rng());
+
+        char name[96];
+        std::snprintf(name, sizeof(name), "tex_%04zu_%ux%u_%s_%s.png", i, spec.width, spec.height,
+                      variantName(spec.alpha), spec.noisy ? "noisy" : "flat");
+        spec.name = name;
+        specs.push_back(spec);
+    }
+    return specs;
+}
+
+uint32_t hash32(uint32_t x, uint32_t y, uint32_t seed) {
+    uint32_t h = seed ^ (x * 0x9E3779B1u) ^ (y * 0x85EBCA77u);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+void fillRow(const TextureSpec& spec, uint32_t y, std::vector<uint8_t>& row) {
+    const uint32_t base = spec.contentSeed;
+    for (uint32_t x = 0; x < spec.width; x++) {
+        uint8_t* px = row.data() + static_cast<size_t>(x) * 4;
+        uint32_t noise = spec.noisy ? hash32(x, y, base) : 0;
+
+        // Gradients give DXT endpoints something to fit; noise defeats them
+        px[0] = static_cast<uint8_t>(std::min<uint32_t>(255, (base & 0x7F) + x * 128 / spec.width + (noise & 0x3F)));
+        px[1] = static_cast<uint8_t>(std::min<uint32_t>(255, ((base >> 8) & 0x7F) + y * 128 / spec.height + ((noise >> 6) & 0x3F)));
+        px[2] = static_cast<uint8_t>(std::min<uint32_t>(255, ((base >> 16) & 0xBF) + ((noise >> 12) & 0x3F)));
+
+        switch (spec.alpha) {
+            case AlphaVariant::Opaque:
+                px[3] = 255;
+                break;
+            case AlphaVariant::Binary:
+                // Coherent 8x8 cells, like cut-out foliage
+                px[3] = (hash32(x / 8, y / 8, base) & 3) ? 255 : 0;
+                break;
+            case AlphaVariant::Full:
+                px[3] = static_cast<uint8_t>(std::min<uint32_t>(255, 32 + (x + y) * 192 / (spec.width + spec.height) + ((noise >> 24) & 0x1F)));
+                break;
+        }
+    }
+}
+
+// Row by row through libpng, so even 8192^2 sources need one row of memory
+void writeTexture(const fs::path& path, const TextureSpec& spec) {
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Failed to create " + path.string());
+    }
+
+    std::vector<uint8_t> row(static_cast<size_t>(spec.width) * 4);
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        std::fclose(file);
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+
+    png_init_io(png, file);
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, spec.width, spec.height, 8, PNG_COLOR_TYPE_RGBA,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (uint32_t y = 0; y < spec.height; y++) {
+        fillRow(spec, y, row);
+        png_write_row(png, row.data());
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+
+    if (std::fclose(file) != 0) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+std::vector<TextureSpec> prepareCorpus(const fs::path& dir, const CorpusSettings& settings) {
+    std::vector<TextureSpec> specs = planCorpus(settings);
+    fs::path stamp = dir / "corpus.txt";
+
+    std::string existing;
+    if (std::ifstream in{stamp}) {
+        std::getline(in, existing);
+    }
+    if (existing == settings.describe()) {
+        bool complete = std::all_of(specs.begin(), specs.end(),
+                                    [&](const TextureSpec& spec) { return fs::exists(dir / spec.name); });
+        if (complete) {
+            std::printf("Reusing corpus in %s\n", dir.string().c_str());
+            return specs;
+        }
+    }
+
+    // Only ever wipe a directory this tool created
+    if (fs::exists(dir) && !fs::is_empty(dir) && !fs::exists(stamp)) {
+        throw std::runtime_error(dir.string() + " is not empty and holds no generated corpus");
+    }
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::printf("Generating %zu textures in %s ...\n", specs.size(), dir.string().c_str());
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& spec : specs) {
+        writeTexture(dir / spec.name, spec);
+    }
+    std::ofstream(stamp) << settings.describe() << "\n";
+    std::printf("Generated in %.1f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return specs;
+}
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+};
+
+struct SizeClass {
+    size_t files = 0;
+    uint64_t pixels = 0;
+    double ms = 0.0;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--files N] [--min-side N] [--max-side N] [--exponent X] [--seed N]\n"
+              << "       [--corpus <dir>] [--threads N] [--io <backend>] [--quality fast|balanced|best]\n"
+              << "       [--pin | --compare-pinning] [--json <file>] [--min-mps X] [--verbose]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CorpusSettings corpus;
+    std::string corpusDir;
+    std::string jsonPath;
+    double minMPS = 0.0;
+    bool verbose = false;
+    bool comparePinning = false;
+
+    BatchOptions batch;
+    ConvertOptions convert;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--files" && hasValue) corpus.files = std::stoul(argv[++i]);
+            else if (arg == "--min-side" && hasValue) corpus.minSide = std::stoul(argv[++i]);
+            else if (arg == "--max-side" && hasValue) corpus.maxSide = std::stoul(argv[++i]);
+            else if (arg == "--exponent" && hasValue) corpus.exponent = std::stod(argv[++i]);
+            else if (arg == "--seed" && hasValue) corpus.seed = std::stoull(argv[++i]);
+            else if (arg == "--corpus" && hasValue) corpusDir = argv[++i];
+            else if (arg == "--threads" && hasValue) batch.threads = std::stoul(argv[++i]);
+            else if (arg == "--io" && hasValue) batch.io = parseIOBackend(argv[++i]);
+            else if (arg == "--quality" && hasValue) {
+                std::string tier = argv[++i];
+                if (tier == "fast") convert.tier = EncoderTier::Fast;
+                else if (tier == "balanced") convert.tier = EncoderTier::Balanced;
+                else if (tier == "best") convert.tier = EncoderTier::Best;
+                else throw std::runtime_error("Unknown quality tier: " + tier);
+            }
+            else if (arg == "--pin") batch.pinWorkers = true;
+            else if (arg == "--compare-pinning") comparePinning = true;
+            else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+            else if (arg == "--min-mps" && hasValue) minMPS = std::stod(argv[++i]);
+            else if (arg == "--verbose") verbose = true;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if (corpus.minSide < 4 || corpus.maxSide < corpus.minSide || corpus.maxSide > 8192) {
+            throw std::runtime_error("Sides must satisfy 4 <= --min-side <= --max-side <= 8192");
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::string tag = "arma3-paa-bench";
+#ifdef __linux__
+    tag += "-" + std::to_string(getpid());
+#endif
+    fs::path scratch = fs::temp_directory_path() / tag;
+    fs::path sourceDir = corpusDir.empty() ? scratch / "in" : fs::path(corpusDir);
+    fs::path reportPath = scratch / "report.json";
+    fs::create_directories(scratch);
+
+    int exitCode = 0;
+    try {
+        std::vector<TextureSpec> specs = prepareCorpus(sourceDir, corpus);
+
+        batch.pattern = (sourceDir / "*.png").generic_string();
+        batch.outputDir = (scratch / "out").string();
+        batch.reportPath = reportPath.string();
+
+        auto convertCorpus = [&](bool pin) {
+            BatchOptions options = batch;
+            options.pinWorkers = pin;
+            fs::remove_all(scratch / "out");
+            resetPeakResidentSize();
+
+            // The per-file log lines would swamp the summary
+            NullBuffer null;
+            std::streambuf* saved = std::cout.rdbuf();
+            if (!verbose) std::cout.rdbuf(&null);
+            try {
+                BatchConverter(options, convert).run();
+            }
+            catch (...) {
+                std::cout.rdbuf(saved);
+                throw;
+            }
+            std::cout.rdbuf(saved);
+            return BatchReport::read(reportPath.string());
+        };
+
+        // Compared back to back on the same corpus, so the page cache is
+        // equally warm for both; the detailed tables are for the pinned run
+        std::vector<std::pair<const char*, BatchReport>> placements;
+        if (comparePinning) {
+            placements.emplace_back("unpinned", convertCorpus(false));
+            batch.pinWorkers = true;
+        }
+        BatchReport report = convertCorpus(batch.pinWorkers);
+        uint64_t peak = peakResidentSize();
+        if (comparePinning) {
+            placements.emplace_back("pinned", report);
+        }
+        std::map<std::string, const TextureSpec*> specByName;
+        for (const auto& spec : specs) {
+            specByName[spec.name] = &spec;
+        }
+
+        size_t failed = 0;
+        uint64_t pixels = 0;
+        StageTimes stages;
+        double stageTotal = 0.0;
+        std::map<uint32_t, SizeClass> bySide;
+        for (const auto& file : report.files) {
+            if (!file.ok) {
+                failed++;
+                std::cerr << "✗ " << file.input << ": " << file.error << "\n";
+                continue;
+            }
+            pixels += file.pixels;
+            for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++) {
+                stages.ms[s] += file.stages.ms[s];
+                stageTotal += file.stages.ms[s];
+            }
+            auto spec = specByName.find(fs::path(file.input).filename().string());
+            uint32_t side = spec == specByName.end() ? 0 : std::max(spec->second->width, spec->second->height);
+            SizeClass& sizeClass = bySide[side];
+            sizeClass.files++;
+            sizeClass.pixels += file.pixels;
+            sizeClass.ms += file.milliseconds;
+        }
+
+        double seconds = report.wallSeconds;
+        double megapixels = pixels / 1e6;
+        double filesPerSecond = report.files.size() / seconds;
+        double mps = megapixels / seconds;
+
+        std::printf("\n%zu files, %.1f MP, %s I/O, %s\n", specs.size(), megapixels,
+                    ioBackendName(batch.io), tierName(convert.tier));
+        std::printf("  wall time     %10.2f s\n", seconds);
+        std::printf("  files/s       %10.2f\n", filesPerSecond);
+        std::printf("  MP/s          %10.2f\n", mps);
+        std::printf("  peak RSS      %10.1f MB\n", peak / (1024.0 * 1024.0));
+        std::printf("  failed        %10zu\n", failed);
+
+        std::printf("\n%-8s %12s %7s\n", "stage", "worker s", "share");
+        for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++) {
+            std::printf("%-8s %12.2f %6.1f%%\n", stageName(static_cast<Stage>(s)), stages.ms[s] / 1000.0,
+                        stageTotal > 0.0 ? 100.0 * stages.ms[s] / stageTotal : 0.0);
+        }
+
+        std::printf("\n%-8s %7s %10s %12s %10s\n", "side", "files", "MP", "ms/file", "MP/s/core");
+        for (const auto& [side, sizeClass] : bySide) {
+            std::printf("%-8u %7zu %10.1f %12.1f %10.2f\n", side, sizeClass.files, sizeClass.pixels / 1e6,
+                        sizeClass.ms / sizeClass.files,
+                        sizeClass.ms > 0.0 ? (sizeClass.pixels / 1e6) / (sizeClass.ms / 1000.0) : 0.0);
+        }
+
+        if (!placements.empty()) {
+            std::printf("\n%-10s %10s %10s  %s\n", "placement", "files/s", "MP/s", "files per node");
+            double baseline = 0.0;
+            for (const auto& [name, run] : placements) {
+                uint64_t runPixels = 0;
+                std::map<int, size_t> perNode;
+                for (const auto& file : run.files) {
+                    runPixels += file.pixels;
+                    perNode[file.node]++;
+                }
+                double runMPS = runPixels / 1e6 / run.wallSeconds;
+                if (baseline == 0.0) baseline = runMPS;
+                std::string nodes;
+                for (const auto& [node, files] : perNode) {
+                    nodes += (nodes.empty() ? "" : ", ") + (node < 0 ? std::string("?") : std::to_string(node)) +
+                             ": " + std::to_string(files);
+                }
+                std::printf("%-10s %10.2f %10.2f  %s\n", name, run.files.size() / run.wallSeconds, runMPS,
+                            nodes.c_str());
+            }
+            if (baseline > 0.0) {
+                std::printf("pinned/unpinned: %.3fx (%d NUMA node%s)\n", mps / baseline,
+                            CpuTopology::get().nodeCount, CpuTopology::get().nodeCount == 1 ? "" : "s");
+            }
+        }
+
+        if (!jsonPath.empty()) {
+            std::ofstream json(jsonPath);
+            json << "{\"corpus\":\"" << corpus.describe() << "\""
+                 << ",\"files\":" << report.files.size()
+                 << ",\"failed\":" << failed
+                 << ",\"megapixels\":" << megapixels
+                 << ",\"wall_seconds\":" << seconds
+                 << ",\"files_per_second\":" << filesPerSecond
+                 << ",\"megapixels_per_second\":" << mps
+                 << ",\"peak_rss_bytes\":" << peak
+                 << ",\"pinned\":" << (batch.pinWorkers ? "true" : "false")
+                 << ",\"numa_nodes\":" << CpuTopology::get().nodeCount
+                 << ",\"stages_ms\":{";
+            for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++) {
+                json << (s ? "," : "") << "\"" << stageName(static_cast<Stage>(s)) << "\":" << stages.ms[s];
+            }
+            json << "}}\n";
+        }
+
+        if (failed > 0) {
+            exitCode = 1;
+        } else if (minMPS > 0.0 && mps < minMPS) {
+            std::printf("\nFAIL: %.2f MP/s is below the --min-mps threshold of %.2f\n", mps, minMPS);
+            exitCode = 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        exitCode = 1;
+    }
+
+    fs::remove_all(scratch);
+    return exitCode;
+}
\ No newline at end of file
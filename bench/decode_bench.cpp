@@ -0,0 +1,314 @@
+// Source decoding throughput: stb_image against the native backend
+// (libpng into the output buffer, built-in TGA reader) on the same bytes.
+//
+//   arma3-paa-decode-bench [--size N] [--iterations N] [--dir <dir>]
+//
+// Without --dir, one in-memory image per layout is generated at N x N:
+// PNG RGBA, RGB, grey, palette with tRNS, 16-bit and interlaced, and TGA
+// 32-bit raw and 24-bit RLE. With --dir, every .png/.tga below it is
+// decoded instead. Each file is decoded --iterations times per backend and
+// the fastest run counts. Both backends must produce identical pixels; the
+// exit code is 1 if any file differs or fails to decode.
+
+#include "image_decoders.h"
+#include "image_loader.h"
+
+#include <png.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace arma3;
+
+namespace {
+
+struct Sample {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+uint32_t hash32(uint32_t x, uint32_t y) {
+    uint32_t h = (x * 0x9E3779B1u) ^ (y * 0x85EBCA77u);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 13;
+    return h;
+}
+
+// Gradients with mild noise: compresses like a painted texture, not like
+// random bytes (too slow to inflate) or flat colour (too fast)
+std::vector<uint8_t> makePixels(uint32_t size) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(size) * size * 4);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* px = rgba.data() + (static_cast<size_t>(y) * size + x) * 4;
+            uint32_t noise = hash32(x, y);
+            px[0] = static_cast<uint8_t>(x * 255 / size ^ (noise & 7));
+            px[1] = static_cast<uint8_t>(y * 255 / size ^ ((noise >> 3) & 7));
+            px[2] = static_cast<uint8_t>((x + y) * 127 / size + ((noise >> 6) & 15));
+            px[3] = static_cast<uint8_t>(std::min<uint32_t>(255, 64 + (x ^ y) % 192));
+        }
+    }
+    return rgba;
+}
+
+void appendToVector(png_structp png, png_bytep data, png_size_t length) {
+    auto* out = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png));
+    out->insert(out->end(), data, data + length);
+}
+
+void flushNothing(png_structp) {}
+
+std::vector<uint8_t> encodePNG(const std::vector<uint8_t>& rgba, uint32_t size, int colorType, int bitDepth,
+                               bool interlaced) {
+    std::vector<uint8_t> out;
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        throw std::runtime_error("Failed to encode PNG sample");
+    }
+
+    png_set_write_fn(png, &out, appendToVector, flushNothing);
+    png_set_IHDR(png, info, size, size, bitDepth, colorType,
+                 interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+    std::vector<png_color> palette;
+    if (colorType == PNG_COLOR_TYPE_PALETTE) {
+        // 6x6x6 cube plus transparency on the first entries
+        for (int i = 0; i < 216; i++) {
+            palette.push_back({static_cast<png_byte>(i / 36 * 51), static_cast<png_byte>(i / 6 % 6 * 51),
+                               static_cast<png_byte>(i % 6 * 51)});
+        }
+        png_set_PLTE(png, info, palette.data(), static_cast<int>(palette.size()));
+        png_byte alpha[16];
+        for (int i = 0; i < 16; i++) alpha[i] = static_cast<png_byte>(i * 17);
+        png_set_tRNS(png, info, alpha, 16, nullptr);
+    }
+    png_write_info(png, info);
+    if (bitDepth == 16) {
+        png_set_swap(png);  // rows below are built little-endian
+    }
+
+    int channels = colorType == PNG_COLOR_TYPE_RGBA ? 4 : colorType == PNG_COLOR_TYPE_RGB ? 3
+                 : colorType == PNG_COLOR_TYPE_GRAY ? 1 : 1;
+    size_t bytesPerSample = bitDepth / 8;
+    std::vector<uint8_t> image(static_cast<size_t>(size) * size * channels * bytesPerSample);
+    for (size_t p = 0; p < static_cast<size_t>(size) * size; p++) {
+        const uint8_t* px = rgba.data() + p * 4;
+        uint8_t* dst = image.data() + p * channels * bytesPerSample;
+        for (int c = 0; c < channels; c++) {
+            uint8_t value = colorType == PNG_COLOR_TYPE_PALETTE
+                ? static_cast<uint8_t>(px[0] / 51 * 36 + px[1] / 51 * 6 + px[2] / 51)
+                : colorType == PNG_COLOR_TYPE_GRAY ? px[1] : px[c];
+            if (bytesPerSample == 2) {
+                dst[c * 2] = value ^ static_cast<uint8_t>(p);  // low byte: dropped by both decoders
+                dst[c * 2 + 1] = value;
+            } else {
+                dst[c] = value;
+            }
+        }
+    }
+
+    std::vector<png_bytep> rows(size);
+    for (uint32_t y = 0; y < size; y++) {
+        rows[y] = image.data() + static_cast<size_t>(y) * size * channels * bytesPerSample;
+    }
+    png_write_image(png, rows.data());
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return out;
+}
+
+std::vector<uint8_t> encodeTGA(const std::vector<uint8_t>& rgba, uint32_t size, bool alpha, bool rle) {
+    size_t bytesPerPixel = alpha ? 4 : 3;
+    std::vector<uint8_t> out(18, 0);
+    out[2] = rle ? 10 : 2;
+    out[12] = size & 0xFF;
+    out[13] = size >> 8;
+    out[14] = size & 0xFF;
+    out[15] = size >> 8;
+    out[16] = static_cast<uint8_t>(bytesPerPixel * 8);
+    out[17] = alpha ? 8 : 0;  // bottom-up, the common layout
+
+    auto pixel = [&](size_t index, uint8_t* bgra) {
+        const uint8_t* px = rgba.data() + index * 4;
+        bgra[0] = px[2];
+        bgra[1] = px[1];
+        bgra[2] = px[0];
+        bgra[3] = px[3];
+    };
+
+    for (uint32_t row = 0; row < size; row++) {
+        size_t base = static_cast<size_t>(size - 1 - row) * size;
+        uint32_t x = 0;
+        while (x < size) {
+            uint8_t first[4];
+            pixel(base + x, first);
+            if (!rle) {
+                out.insert(out.end(), first, first + bytesPerPixel);
+                x++;
+                continue;
+            }
+            // Runs of equal pixels, raw packets for the rest (per row)
+            uint32_t run = 1;
+            uint8_t next[4];
+            while (x + run < size && run < 128) {
+                pixel(base + x + run, next);
+                if (std::memcmp(first, next, bytesPerPixel) != 0) break;
+                run++;
+            }
+            if (run > 1) {
+                out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+                out.insert(out.end(), first, first + bytesPerPixel);
+                x += run;
+                continue;
+            }
+            uint32_t count = 1;
+            while (x + count < size && count < 128) {
+                uint8_t a[4], b[4];
+                pixel(base + x + count, a);
+                if (x + count + 1 < size) {
+                    pixel(base + x + count + 1, b);
+                    if (std::memcmp(a, b, bytesPerPixel) == 0) break;
+                }
+                count++;
+            }
+            out.push_back(static_cast<uint8_t>(count - 1));
+            for (uint32_t i = 0; i < count; i++) {
+                pixel(base + x + i, next);
+                out.insert(out.end(), next, next + bytesPerPixel);
+            }
+            x += count;
+        }
+    }
+    return out;
+}
+
+std::vector<Sample> generateSamples(uint32_t size) {
+    std::vector<uint8_t> rgba = makePixels(size);
+    std::vector<Sample> samples;
+    samples.push_back({"png rgba", encodePNG(rgba, size, PNG_COLOR_TYPE_RGBA, 8, false)});
+    samples.push_back({"png rgb", encodePNG(rgba, size, PNG_COLOR_TYPE_RGB, 8, false)});
+    samples.push_back({"png grey", encodePNG(rgba, size, PNG_COLOR_TYPE_GRAY, 8, false)});
+    samples.push_back({"png palette", encodePNG(rgba, size, PNG_COLOR_TYPE_PALETTE, 8, false)});
+    samples.push_back({"png rgba16", encodePNG(rgba, size, PNG_COLOR_TYPE_RGBA, 16, false)});
+    samples.push_back({"png adam7", encodePNG(rgba, size, PNG_COLOR_TYPE_RGBA, 8, true)});
+    samples.push_back({"tga 32 raw", encodeTGA(rgba, size, true, false)});
+    samples.push_back({"tga 24 rle", encodeTGA(rgba, size, false, true)});
+    return samples;
+}
+
+std::vector<Sample> loadSamples(const fs::path& dir) {
+    std::vector<Sample> samples;
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (!entry.is_regular_file() || (ext != ".png" && ext != ".tga")) continue;
+
+        std::ifstream in(entry.path(), std::ios::binary);
+        Sample sample;
+        sample.name = entry.path().generic_string();
+        sample.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        samples.push_back(std::move(sample));
+    }
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.name < b.name; });
+    return samples;
+}
+
+// Fastest of `iterations` decodes; the buffer is reused like a batch worker would
+double bestSeconds(const Sample& sample, ImageDecoder decoder, int iterations, ImageData& image) {
+    ImageLoader::setDecoder(decoder);
+    // Generated names carry no extension; the TGA reader is picked by name
+    std::string name = sample.name.compare(0, 3, "tga") == 0 ? sample.name + ".tga" : sample.name;
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        ImageLoader::decodeInto(sample.bytes.data(), sample.bytes.size(), name, image);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--size N] [--iterations N] [--dir <dir>]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t size = 2048;
+    int iterations = 5;
+    std::string dir;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--size" && hasValue) size = std::stoul(argv[++i]);
+            else if (arg == "--iterations" && hasValue) iterations = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--dir" && hasValue) dir = argv[++i];
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if (size < 1 || size > 16384) {
+            throw std::runtime_error("--size must be between 1 and 16384");
+        }
+
+        std::vector<Sample> samples = dir.empty() ? generateSamples(size) : loadSamples(dir);
+        if (samples.empty()) {
+            throw std::runtime_error("No .png or .tga files in " + dir);
+        }
+
+        std::printf("%-24s %8s %10s %10s %9s  %s\n", "file", "MP", "stb MP/s", "native", "speedup", "pixels");
+        int mismatches = 0;
+        double stbTotal = 0.0, nativeTotal = 0.0, megapixelsTotal = 0.0;
+        for (const auto& sample : samples) {
+            std::string label = sample.name.size() > 24 ? "..." + sample.name.substr(sample.name.size() - 21) : sample.name;
+            ImageData stb, native;
+            double stbSeconds, nativeSeconds;
+            try {
+                stbSeconds = bestSeconds(sample, ImageDecoder::Stb, iterations, stb);
+                nativeSeconds = bestSeconds(sample, ImageDecoder::Native, iterations, native);
+            }
+            catch (const std::exception& e) {
+                std::printf("%-24s %s\n", label.c_str(), e.what());
+                mismatches++;
+                continue;
+            }
+
+            bool same = stb.width == native.width && stb.height == native.height && stb.data == native.data;
+            mismatches += same ? 0 : 1;
+
+            double megapixels = static_cast<double>(stb.width) * stb.height / 1e6;
+            stbTotal += stbSeconds;
+            nativeTotal += nativeSeconds;
+            megapixelsTotal += megapixels;
+
+            std::printf("%-24s %8.2f %10.1f %10.1f %8.2fx  %s\n", label.c_str(), megapixels,
+                        megapixels / stbSeconds, megapixels / nativeSeconds, stbSeconds / nativeSeconds,
+                        same ? "identical" : "DIFFERENT");
+        }
+
+        std::printf("%-24s %8.2f %10.1f %10.1f %8.2fx\n", "total", megapixelsTotal,
+                    megapixelsTotal / stbTotal, megapixelsTotal / nativeTotal, stbTotal / nativeTotal);
+        return mismatches == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+// Compares the async file I/O backends on a set of files: whole-file reads
+// followed by writes of the same bytes, with every request issued up front
+// the way the batch converter does.
+//
+//   arma3-paa-io-bench [--dir <dir>] [--files N] [--size KB] [--depth N]
+//
+// Without --dir a temporary corpus of N random files is generated. Reads are
+// usually served from the page cache on a second run; point --dir at a cold
+// tree (or drop caches) to measure the device.
+
+#include "async_io.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Result {
+    const char* name;
+    double readSeconds = 0.0;
+    double writeSeconds = 0.0;
+    uint64_t bytes = 0;
+    size_t errors = 0;
+};
+
+std::vector<std::string> generateCorpus(const fs::path& dir, size_t files, size_t sizeKB) {
+    fs::create_directories(dir);
+    std::mt19937_64 rng(42);
+    std::vector<uint8_t> data(sizeKB * 1024);
+    std::vector<std::string> paths;
+
+    for (size_t i = 0; i < files; i++) {
+        for (size_t j = 0; j + 8 <= data.size(); j += 8) {
+            uint64_t value = rng();
+            std::copy(reinterpret_cast<uint8_t*>(&value), reinterpret_cast<uint8_t*>(&value) + 8, data.begin() + j);
+        }
+        std::string path = (dir / ("source_" + std::to_string(i) + ".bin")).string();
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+std::vector<std::string> listCorpus(const fs::path& dir) {
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file()) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    return paths;
+}
+
+Result runBackend(arma3::IOBackend backend, size_t depth,
+                  const std::vector<std::string>& paths, const fs::path& outDir) {
+    auto io = arma3::AsyncFileIO::create(backend, depth);
+    Result result;
+    result.name = arma3::ioBackendName(io->backend());
+
+    std::vector<std::vector<uint8_t>> contents(paths.size());
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<size_t> errors{0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); i++) {
+        io->readFile(paths[i], [&, i](std::vector<uint8_t> data, const std::string& error) {
+            if (!error.empty()) errors++;
+            bytes += data.size();
+            contents[i] = std::move(data);
+        });
+    }
+    io->drain();
+    result.readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string path = (outDir / ("out_" + std::to_string(i) + ".bin")).string();
+        io->writeFile(path, std::move(contents[i]), [&](const std::string& error) {
+            if (!error.empty()) errors++;
+        });
+    }
+    io->drain();
+    result.writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.bytes = bytes;
+    result.errors = errors;
+    return result;
+}
+
+// What each batch worker did before the async layer: one file at a time
+Result runBlocking(const std::vector<std::string>& paths, const fs::path& outDir) {
+    Result result;
+    result.name = "blocking";
+    std::vector<std::vector<uint8_t>> contents(paths.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::ifstream in(paths[i], std::ios::binary | std::ios::ate);
+        if (!in) {
+            result.errors++;
+            continue;
+        }
+        contents[i].resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(contents[i].data()), contents[i].size());
+        result.bytes += contents[i].size();
+    }
+    result.readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::ofstream out((outDir / ("out_" + std::to_string(i) + ".bin")).string(), std::ios::binary);
+        if (!out.write(reinterpret_cast<const char*>(contents[i].data()), contents[i].size())) {
+            result.errors++;
+        }
+    }
+    result.writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void printResult(const Result& result, size_t files) {
+    double mb = result.bytes / (1024.0 * 1024.0);
+    std::printf("%-10s %10.1f %10.1f %12.0f %12.0f %7zu\n", result.name,
+                mb / result.readSeconds, mb / result.writeSeconds,
+                files / result.readSeconds, files / result.writeSeconds, result.errors);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string dir;
+    size_t files = 512;
+    size_t sizeKB = 1024;
+    size_t depth = 64;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) dir = argv[++i];
+        else if (arg == "--files" && i + 1 < argc) files = std::stoul(argv[++i]);
+        else if (arg == "--size" && i + 1 < argc) sizeKB = std::stoul(argv[++i]);
+        else if (arg == "--depth" && i + 1 < argc) depth = std::stoul(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--dir <dir>] [--files N] [--size KB] [--depth N]\n";
+            return 1;
+        }
+    }
+
+    std::string tag = "arma3-paa-io-bench";
+#ifdef __linux__
+    tag += "-" + std::to_string(getpid());
+#endif
+    fs::path scratch = fs::temp_directory_path() / tag;
+    fs::path outDir = scratch / "out";
+    fs::create_directories(outDir);
+
+    try {
+        std::vector<std::string> paths = dir.empty()
+            ? generateCorpus(scratch / "in", files, sizeKB)
+            : listCorpus(dir);
+
+        std::printf("%zu files, queue depth %zu, io_uring %s\n\n", paths.size(), depth,
+                    arma3::ioUringAvailable() ? "available" : "unavailable");
+        std::printf("%-10s %10s %10s %12s %12s %7s\n",
+                    "backend", "read MB/s", "write MB/s", "reads/s", "writes/s", "errors");
+
+        printResult(runBlocking(paths, outDir), paths.size());
+        printResult(runBackend(arma3::IOBackend::Threads, depth, paths, outDir), paths.size());
+        if (arma3::ioUringAvailable()) {
+            printResult(runBackend(arma3::IOBackend::IoUring, depth, paths, outDir), paths.size());
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        fs::remove_all(scratch);
+        return 1;
+    }
+
+    fs::remove_all(scratch);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+// Where an allocation is charged. Finer than Stage: the encoder's copy of
+// the mip chain, squish output buffers and TAGGs are reported separately
+enum class MemoryStage {
+    Other,
+    Decode,       // ImageLoader decode of the source
+    Mips,         // generatedMips (mip chain)
+    EncodedMips,  // encodedMips (working copy for DXT compression)
+    Squish,       // squish block buffers
+    Taggs,        // Tagg vectors
+    Layout,       // serialized headers and segment lists
+    Count
+};
+
+const char* memoryStageName(MemoryStage stage);
+
+struct AllocCounters {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+// Allocations made on a job's thread while it converted one file
+struct FileMemory {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    int64_t peakBytes = 0;  // peak live bytes above the level at job start
+};
+
+struct ThreadAllocation {
+    uint32_t index = 0;      // registration order
+    uint64_t files = 0;      // jobs recorded on this thread (workers have > 0)
+    AllocCounters total;
+    uint64_t frees = 0;
+    int64_t peakBytes = 0;   // peak live bytes allocated minus freed on this thread
+};
+
+struct AllocationSnapshot {
+    AllocCounters stages[static_cast<size_t>(MemoryStage::Count)];
+    std::vector<ThreadAllocation> threads;
+    int64_t peakLiveBytes = 0;   // process-wide, while tracking was on
+    uint64_t peakResidentBytes = 0;
+};
+
+// Set by enableAllocationTracking(); the allocation hooks test it with one
+// relaxed load, so a build with hooks costs nothing measurable while it's off
+extern std::atomic<bool> allocationTracking;
+
+// True when this executable links the operator new/delete hooks (alloc_hooks.cpp)
+bool allocationHooksInstalled();
+
+void enableAllocationTracking();
+void disableAllocationTracking();
+
+// Called by the hooks with the block's usable size
+void recordAllocation(size_t size);
+void recordFree(size_t size);
+
+// Charges allocations on this thread to `stage` while alive
+class MemoryStageScope {
+public:
+    explicit MemoryStageScope(MemoryStage stage);
+    ~MemoryStageScope();
+
+    MemoryStageScope(const MemoryStageScope&) = delete;
+    MemoryStageScope& operator=(const MemoryStageScope&) = delete;
+
+private:
+    MemoryStage previous;
+};
+
+// Charges allocations on this thread to one file while alive
+class FileMemoryRecorder {
+public:
+    explicit FileMemoryRecorder(FileMemory& memory);
+    ~FileMemoryRecorder();
+
+    FileMemoryRecorder(const FileMemoryRecorder&) = delete;
+    FileMemoryRecorder& operator=(const FileMemoryRecorder&) = delete;
+
+private:
+    FileMemory* previous;
+    int64_t startLive;
+};
+
+AllocationSnapshot snapshotAllocations();
+
+// Peak resident set size of the process in bytes (0 if unknown). The reset
+// is Linux only; elsewhere the peak covers the whole process lifetime
+uint64_t peakResidentSize();
+void resetPeakResidentSize();
+
+struct NamedFileMemory {
+    std::string path;
+    uint64_t pixels = 0;
+    FileMemory memory;
+};
+
+// Human-readable tables and the JSON equivalent; `files` are listed in the
+// order given (pass the heaviest first)
+void printAllocationStats(std::ostream& out, const AllocationSnapshot& snapshot,
+                          const std::vector<NamedFileMemory>& files);
+std::string allocationStatsToJSON(const AllocationSnapshot& snapshot,
+                                  const std::vector<NamedFileMemory>& files);
+
+} // namespace arma3
\ No newline at end of file
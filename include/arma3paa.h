@@ -0,0 +1,153 @@
+/*
+ * libarma3paa - C interface to the PAA encoder/decoder
+ *
+ * All buffers are owned by the caller. Encoding writes the finished PAA
+ * straight into the caller's output buffer, inspection and decoding read
+ * the caller's PAA bytes in place, and decoded pixels are written directly
+ * into the caller's RGBA buffer. Every function is safe to call from any
+ * thread; a context may be shared by several threads.
+ */
+#ifndef ARMA3PAA_H
+#define ARMA3PAA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(ARMA3PAA_BUILD)
+#    define ARMA3PAA_API __declspec(dllexport)
+#  else
+#    define ARMA3PAA_API __declspec(dllimport)
+#  endif
+#else
+#  define ARMA3PAA_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a struct or signature below changes incompatibly */
+#define ARMA3PAA_ABI_VERSION 1
+
+#define ARMA3PAA_MAX_MIPS 16
+
+/* Status codes returned by every call */
+#define ARMA3PAA_OK 0
+#define ARMA3PAA_ERROR_INVALID_ARGUMENT 1
+#define ARMA3PAA_ERROR_BUFFER_TOO_SMALL 2  /* required size is still reported */
+#define ARMA3PAA_ERROR_CORRUPT 3
+#define ARMA3PAA_ERROR_UNSUPPORTED 4
+#define ARMA3PAA_ERROR_FAILED 5
+
+/* PAA formats, identical to the magic number stored in the file */
+#define ARMA3PAA_FORMAT_AUTO 0  /* DXT5 when the image has alpha, DXT1 otherwise */
+#define ARMA3PAA_FORMAT_DXT1 0xFF01
+#define ARMA3PAA_FORMAT_DXT2 0xFF02  /* DXT3 with premultiplied colour */
+#define ARMA3PAA_FORMAT_DXT3 0xFF03
+#define ARMA3PAA_FORMAT_DXT4 0xFF04  /* DXT5 with premultiplied colour */
+#define ARMA3PAA_FORMAT_DXT5 0xFF05
+
+#define ARMA3PAA_QUALITY_FAST 0
+#define ARMA3PAA_QUALITY_BALANCED 1
+#define ARMA3PAA_QUALITY_BEST 2
+
+#define ARMA3PAA_MIP_FILTER_BOX 0
+#define ARMA3PAA_MIP_FILTER_KAISER 1
+#define ARMA3PAA_MIP_FILTER_LANCZOS 2
+
+typedef struct arma3paa_encode_options {
+    uint32_t struct_size;     /* sizeof(arma3paa_encode_options), set by _init */
+    uint32_t format;          /* ARMA3PAA_FORMAT_* */
+    uint32_t quality;         /* ARMA3PAA_QUALITY_* */
+    uint32_t max_size;        /* cap on the top level's longer side, 0 = none */
+    uint32_t drop_mips;       /* drop this many top levels */
+    uint32_t mip_filter;      /* ARMA3PAA_MIP_FILTER_* */
+    uint32_t srgb_mips;       /* non-zero: Kaiser/Lanczos filter in sRGB */
+    float alpha_coverage;     /* alpha-test cutoff whose coverage mips keep, 0 = off */
+} arma3paa_encode_options;
+
+typedef struct arma3paa_mip_info {
+    uint32_t width;
+    uint32_t height;
+    uint32_t data_size;       /* stored payload bytes */
+    uint32_t lzo_compressed;
+} arma3paa_mip_info;
+
+typedef struct arma3paa_info {
+    uint32_t format;          /* ARMA3PAA_FORMAT_* or another PAA magic */
+    uint32_t width;           /* top level */
+    uint32_t height;
+    uint32_t mip_count;       /* may exceed ARMA3PAA_MAX_MIPS; only that many are described */
+    uint32_t has_alpha;
+    uint8_t average_color[4]; /* GGATCGVA as stored */
+    uint8_t max_color[4];     /* GGATCXAM as stored */
+    arma3paa_mip_info mips[ARMA3PAA_MAX_MIPS];
+} arma3paa_info;
+
+#define ARMA3PAA_JOB_ENCODE 0
+#define ARMA3PAA_JOB_DECODE 1
+
+typedef struct arma3paa_job {
+    uint32_t kind;            /* ARMA3PAA_JOB_* */
+
+    /* Encode: RGBA pixels (width * height * 4 bytes). Decode: a PAA file */
+    const uint8_t* input;
+    size_t input_size;
+    uint32_t width;           /* encode: image size; decode: set to the level's size */
+    uint32_t height;
+    uint32_t mip_level;       /* decode only */
+    const arma3paa_encode_options* options;  /* encode only, NULL for defaults */
+
+    /* Encode: the PAA file. Decode: RGBA pixels */
+    uint8_t* output;
+    size_t output_capacity;
+
+    /* Results */
+    size_t output_size;
+    int status;
+    char error[160];
+} arma3paa_job;
+
+/* Reusable worker pool for batch calls */
+typedef struct arma3paa_context arma3paa_context;
+
+ARMA3PAA_API uint32_t arma3paa_abi_version(void);
+
+/* Message for the last failed call on this thread ("" if none) */
+ARMA3PAA_API const char* arma3paa_last_error(void);
+
+ARMA3PAA_API void arma3paa_encode_options_init(arma3paa_encode_options* options);
+
+/* Output capacity that always suffices for a width x height image */
+ARMA3PAA_API size_t arma3paa_encode_bound(uint32_t width, uint32_t height);
+
+/* Encode RGBA pixels into `out`. On ARMA3PAA_ERROR_BUFFER_TOO_SMALL
+ * *out_size holds the size that is needed */
+ARMA3PAA_API int arma3paa_encode(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                 const arma3paa_encode_options* options,
+                                 uint8_t* out, size_t capacity, size_t* out_size);
+
+/* Read the headers only; no pixel data is touched */
+ARMA3PAA_API int arma3paa_inspect(const uint8_t* paa, size_t size, arma3paa_info* info);
+
+/* Decode one mip level into `rgba` (at least width * height * 4 bytes of
+ * that level, see arma3paa_inspect). Output always has straight alpha,
+ * also for the premultiplied DXT2/DXT4 */
+ARMA3PAA_API int arma3paa_decode_mip(const uint8_t* paa, size_t size, uint32_t level,
+                                     uint8_t* rgba, size_t capacity);
+
+/* threads == 0 uses one worker per hardware thread */
+ARMA3PAA_API arma3paa_context* arma3paa_context_create(uint32_t threads);
+ARMA3PAA_API void arma3paa_context_destroy(arma3paa_context* context);
+
+/* Run every job on the context's pool and return once all have finished.
+ * Each job reports its own status; the call returns ARMA3PAA_OK only if
+ * all jobs succeeded, otherwise the status of the first failed job */
+ARMA3PAA_API int arma3paa_run_batch(arma3paa_context* context, arma3paa_job* jobs, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARMA3PAA_H */
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+enum class IOBackend {
+    Blocking,  // no async layer: workers read and write files themselves
+    Threads,   // dedicated I/O threads doing blocking reads/writes
+    IoUring,   // Linux io_uring
+    Auto       // io_uring when the kernel allows it, threads otherwise
+};
+
+const char* ioBackendName(IOBackend backend);
+IOBackend parseIOBackend(const std::string& name);
+
+// Completion callbacks run on an I/O thread (or on the caller when the file
+// cannot be opened); keep them short and never block inside them.
+// `error` is empty on success.
+using ReadCallback = std::function<void(std::vector<uint8_t> data, const std::string& error)>;
+using WriteCallback = std::function<void(const std::string& error)>;
+
+// Whole-file asynchronous reads and writes, used by the batch converter so
+// encode threads hand I/O off instead of waiting on it
+class AsyncFileIO {
+public:
+    virtual ~AsyncFileIO() = default;
+
+    virtual void readFile(const std::string& path, ReadCallback onDone) = 0;
+
+    // Create or truncate `path` and write `data` to it
+    virtual void writeFile(const std::string& path, std::vector<uint8_t> data, WriteCallback onDone) = 0;
+
+    // Block until every submitted request has completed and its callback returned
+    virtual void drain() = 0;
+
+    virtual IOBackend backend() const = 0;
+
+    // Returns nullptr for IOBackend::Blocking. Asking for IoUring explicitly
+    // throws if the ring can't be set up; Auto falls back to threads
+    static std::unique_ptr<AsyncFileIO> create(IOBackend backend, size_t queueDepth = 64);
+};
+
+// True when this build and the running kernel support the io_uring backend
+bool ioUringAvailable();
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "paa.h"
+#include "async_io.h"
+#include "batch_report.h"
+#include "build_manifest.h"
+#include "file_discovery.h"
+#include "file_watcher.h"
+#include "metrics.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace arma3 {
+
+struct ConvertOptions {
+    PAAFormat format = PAAFormat::UNKNOWN;
+    EncoderTier tier = EncoderTier::Balanced;
+    bool autoMode = false;
+    AutoEncodeSettings autoSettings;
+    MipSettings mips;
+    bool atomicWrite = false;  // write to a temporary and rename into place
+};
+
+struct ConvertResult {
+    std::string note;  // short remark for the log line (may be empty)
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+const char* tierName(EncoderTier tier);
+const char* alphaName(AlphaKind alpha);
+
+// Anything that changes the bytes written must feed into this hash, so that
+// --incremental rebuilds everything when settings change
+uint64_t settingsHash(const ConvertOptions& options);
+
+// Load, encode and write one texture
+ConvertResult convertFile(const std::string& input, const std::string& output, const ConvertOptions& options);
+
+// Same, for a source file already read into memory; the PAA bytes go to `encoded`
+ConvertResult convertBuffer(const std::vector<uint8_t>& source, const std::string& name,
+                            const ConvertOptions& options, std::vector<uint8_t>& encoded);
+
+struct BatchOptions {
+    std::string pattern;      // glob, e.g. "**/*.png"
+    std::string filesFrom;    // NUL-separated list instead of a pattern ("-" = stdin)
+    std::string outputDir;    // empty: next to each source
+    bool incremental = false;
+    std::string reportPath;
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 1;
+    size_t threads = 0;       // 0 = one per hardware thread
+    bool pinWorkers = false;  // one CPU per worker, spread over NUMA nodes
+    bool bufferPool = true;   // workers recycle decode/mip/DXT buffers across jobs
+    IOBackend io = IOBackend::Blocking;
+    size_t ioQueueDepth = 64; // requests in flight for the async backends
+    bool stats = false;       // allocation accounting per stage, thread and file
+    std::string statsPath;    // also write it as JSON
+    std::string watchDir;     // --watch: reconvert sources below it as they change
+    uint32_t debounceMs = 250;
+    std::string metricsPath;  // Prometheus text file, rewritten while running
+    uint32_t metricsIntervalMs = 10000;
+};
+
+// Batch conversion. Files are converted on a worker pool as discovery
+// finds them, so encoding starts before a large tree is fully scanned.
+class BatchConverter {
+public:
+    BatchConverter(const BatchOptions& batchOptions, const ConvertOptions& convertOptions);
+
+    // Discover, convert, prune and report; returns the process exit code
+    int run();
+
+    // Reconvert PNG/TGA sources below batch.watchDir whenever they change,
+    // until SIGINT/SIGTERM. Writes are always atomic so a game or tool
+    // reading the outputs never sees a partial PAA
+    int watch();
+
+    // Queue one file on the worker pool (thread-safe)
+    void submit(const DiscoveredFile& file);
+
+    // Block until every queued file has been converted
+    void wait() { pool.wait(); }
+
+    std::string outputPathFor(const DiscoveredFile& file) const;
+
+private:
+    struct Job {
+        DiscoveredFile file;
+        std::string outFile;
+        ManifestEntry entry;
+        FileResult result;
+        bool prepared = false;
+        FailureCause cause = FailureCause::Other;  // set when the job fails
+        std::future<std::vector<uint8_t>> source;  // read issued ahead (async I/O only)
+        std::chrono::high_resolution_clock::time_point start;
+    };
+
+    bool prepare(Job& job);  // true when the output is already up to date
+    void readAhead(const std::shared_ptr<Job>& job);
+    void releaseReadAhead();
+    void convertOne(const std::shared_ptr<Job>& job);
+    void complete(Job& job, const ConvertResult& converted, const std::string& error);
+    void discover(const std::function<void(const DiscoveredFile&)>& onFile);
+    void submitSharded();
+    void reportMemory();
+    void schedule(const std::string& path);
+    std::unique_ptr<MetricsExporter> startMetrics();
+
+    BatchOptions batch;
+    ConvertOptions convert;
+    uint64_t currentSettings;
+
+    BuildManifest manifest;
+    std::string manifestPath;
+
+    std::mutex mutex;  // guards report, seenSources, outputSources, the watch sets and console output
+    BatchReport report;
+    std::unordered_set<std::string> seenSources;
+    std::unordered_map<std::string, std::string> outputSources;  // output -> the source that claimed it
+
+    // Watch mode: a source that changes while it is being converted is
+    // queued again rather than converted twice concurrently
+    FileWatcher* watcher = nullptr;
+    std::unordered_set<std::string> inFlight;
+    std::unordered_set<std::string> dirty;
+    std::vector<std::string> reruns;
+
+    std::atomic<size_t> discoveredCount{0};
+    std::atomic<int> successCount{0};
+    std::atomic<int> failCount{0};
+    std::atomic<int> upToDateCount{0};
+
+    // Bounds how many sources are held in memory ahead of the workers
+    std::mutex readAheadMutex;
+    std::condition_variable readAheadSlot;
+    size_t readAheadCount = 0;
+    size_t readAheadLimit = 0;
+
+    ThreadPool pool;
+    std::unique_ptr<AsyncFileIO> io;  // null for IOBackend::Blocking
+};
+
+} // namespace arma3
\ No newline at end of file
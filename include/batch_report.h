@@ -0,0 +1,65 @@
+#pragma once
+
+#include "alloc_stats.h"
+#include "stage_timer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+struct FileResult {
+    std::string input;
+    std::string output;
+    bool ok = true;
+    bool skipped = false;  // up to date (--incremental)
+    std::string error;
+    double milliseconds = 0.0;
+    uint64_t pixels = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    StageTimes stages;
+    FileMemory memory;  // filled with --stats
+    int node = -1;      // NUMA node the worker ran on (-1 unknown)
+};
+
+// Machine-readable result of one batch run (one shard)
+struct BatchReport {
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 1;
+    double wallSeconds = 0.0;
+    uint64_t bufferPoolHits = 0;    // acquires served by recycled buffers
+    uint64_t bufferPoolMisses = 0;  // acquires that allocated
+    std::vector<FileResult> files;
+
+    void write(const std::string& path) const;
+    static BatchReport read(const std::string& path);
+};
+
+struct ShardSummary {
+    uint32_t shardIndex = 0;
+    size_t files = 0;
+    size_t succeeded = 0;
+    size_t failed = 0;
+    size_t skipped = 0;
+    double wallSeconds = 0.0;
+    double encodeSeconds = 0.0;
+    uint64_t pixels = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+};
+
+struct MergedReport {
+    std::vector<ShardSummary> shards;
+    ShardSummary totals;                  // wallSeconds = slowest shard
+    double imbalance = 1.0;               // slowest / mean shard wall time
+    std::vector<std::pair<uint32_t, FileResult>> failures;  // (shard, result)
+    std::vector<uint32_t> missingShards;  // indices absent from the inputs
+
+    std::string toJSON() const;
+};
+
+MergedReport mergeReports(const std::vector<BatchReport>& reports);
+
+} // namespace arma3
\ No newline at end of file
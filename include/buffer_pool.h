@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace arma3 {
+
+// Counters summed over every thread's pool since process start
+struct BufferPoolStats {
+    uint64_t hits = 0;         // acquires served by a recycled buffer
+    uint64_t misses = 0;       // acquires that had to allocate
+    uint64_t recycled = 0;     // buffers handed back and kept
+    uint64_t dropped = 0;      // handed back but freed (size class full)
+    uint64_t pooledBytes = 0;  // capacity currently held by all pools
+};
+
+// Recycled byte buffers for one thread, binned by capacity in power-of-two
+// size classes. A batch worker converts the same kinds of texture over and
+// over, so after the first few jobs every decode, mip and DXT buffer it
+// needs is already here. Not thread-safe: each thread owns its own pool.
+class BufferPool {
+public:
+    // Smaller buffers are cheap for malloc and are left to it
+    static constexpr size_t MinBufferSize = 64 * 1024;
+    // Kept per size class; a job needs at most a few buffers of one class
+    static constexpr size_t MaxPerClass = 4;
+
+    BufferPool() = default;
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // A buffer of `size` bytes with unspecified contents. A recycled one
+    // keeps its old bytes up to the size it was recycled at; std::vector
+    // zero-fills the rest, so the pool saves the allocation, not the fill
+    std::vector<uint8_t> acquire(size_t size);
+
+    void recycle(std::vector<uint8_t>&& buffer);
+
+    // Free everything held
+    void clear();
+
+private:
+    static constexpr size_t ClassCount = 64;
+    std::vector<std::vector<uint8_t>> classes[ClassCount];  // by floor(log2(capacity))
+};
+
+// Give the calling thread a pool (batch workers do this). Threads without
+// one allocate and free as usual, so the functions below are safe anywhere
+void enableThreadBufferPool();
+bool threadBufferPoolEnabled();
+
+// Free the calling thread's pool
+void disableThreadBufferPool();
+
+// `size` bytes with unspecified contents, from the thread's pool if it has one
+std::vector<uint8_t> acquireBuffer(size_t size);
+
+// Resize `buffer` to `size`. When its capacity is too small it is swapped
+// for a pooled one instead of reallocating; the contents are not kept
+void resizeBuffer(std::vector<uint8_t>& buffer, size_t size);
+
+// Hand a buffer back to the thread's pool; freed if there is none
+void recycleBuffer(std::vector<uint8_t>&& buffer);
+
+BufferPoolStats bufferPoolStats();
+
+} // namespace arma3
\ No newline at end of file
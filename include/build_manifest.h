@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace arma3 {
+
+struct ManifestEntry {
+    std::string sourcePath;
+    std::string outputPath;
+    uint64_t sourceSize = 0;
+    int64_t sourceMtime = 0;   // file_time_type ticks
+    uint64_t settingsHash = 0;
+    uint64_t outputSize = 0;
+};
+
+// Compact binary record of what was built from what, used by --incremental.
+// A source is rebuilt when its size, mtime or the conversion settings
+// changed, or its output is gone; unchanged sources are never opened.
+// All members are safe to call from multiple worker threads.
+class BuildManifest {
+public:
+    static std::string defaultPath(const std::string& outputDir);
+
+    // Missing or unreadable manifests load as empty (everything rebuilds)
+    bool load(const std::string& path);
+
+    // Written to a temporary file and renamed into place
+    void save(const std::string& path) const;
+
+    bool isUpToDate(const std::string& source, uint64_t size, int64_t mtime,
+                    uint64_t settingsHash, const std::string& output) const;
+
+    void record(const ManifestEntry& entry);
+
+    // Drop entries whose source no longer exists (skipping the ones in
+    // `seen`, which were just found on disk) and return them so the caller
+    // can delete the outputs
+    std::vector<ManifestEntry> pruneMissing(const std::unordered_set<std::string>& seen);
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, ManifestEntry> entries;
+};
+
+} // namespace arma3
\ No newline at end of file
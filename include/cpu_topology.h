@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace arma3 {
+
+// Logical CPUs this process may run on, grouped by NUMA node. Read from
+// sysfs on Linux; elsewhere (or without sysfs) it is one node and no CPUs,
+// and pinning is a no-op.
+struct CpuTopology {
+    struct Cpu {
+        int id = 0;
+        int node = 0;
+        int package = 0;
+        int core = 0;      // physical core id within the package
+        int sibling = 0;   // 0 for the first hardware thread of its core, 1 for the next, ...
+    };
+
+    std::vector<Cpu> cpus;  // sorted by id
+    int nodeCount = 1;
+
+    // Detected once per process
+    static const CpuTopology& get();
+
+    int nodeOf(int cpu) const;  // -1 if unknown
+
+    // A CPU for each of `workers` pinned workers. Workers alternate between
+    // nodes; within a node every physical core gets one before any SMT
+    // sibling does, so workers only share L1/L2 once the cores run out.
+    // Empty when the topology is unknown
+    std::vector<int> placement(size_t workers) const;
+};
+
+// Pin the calling thread to `cpu`. The kernel's default local allocation
+// then puts every page the thread first touches (decoded image, mip chain,
+// DXT blocks) on that CPU's node. Returns false if unsupported or refused
+bool pinCurrentThread(int cpu);
+
+// True once pinCurrentThread() succeeded on this thread
+bool currentThreadPinned();
+
+// NUMA node the calling thread is running on, -1 if unknown
+int currentNode();
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+struct DiscoveredFile {
+    std::string path;          // usable with the filesystem, '/'-separated
+    std::string relativePath;  // path below the pattern's base directory
+};
+
+// Glob over '/'-separated paths: `*` and `?` stay within one component,
+// `[abc]`/`[a-z]`/`[!x]` are character classes and a `**` component matches
+// any number of directories. Case-insensitive on Windows.
+class GlobPattern {
+public:
+    explicit GlobPattern(const std::string& pattern);
+
+    // Leading wildcard-free directories, e.g. "textures" for "textures/*_co.tga"
+    const std::string& baseDirectory() const { return base; }
+
+    bool matches(const std::string& relativePath) const;
+
+    // Could anything below this directory (relative to the base) match?
+    bool canMatchBelow(const std::string& relativeDir) const;
+
+private:
+    std::vector<std::string> segments;  // pattern components after the base
+    std::string base;
+};
+
+// Streams matches to `onFile` as they are found. Directories are listed in
+// parallel on an internal pool; onFile is called from those threads and must
+// be thread-safe. Symlinked directories are skipped; symlinked files are
+// reported. Returns once the whole tree has been walked.
+void discoverFiles(const std::string& pattern, const std::function<void(const DiscoveredFile&)>& onFile,
+                   size_t threads = 4);
+
+// NUL-delimited path list (e.g. from `find -print0`); paths are not filtered.
+// relativePath is the path below the current directory. Files outside it
+// keep their whole absolute path minus the root, so /a/x.png and
+// /b/x.png stay apart and no entry reaches outside --output-dir
+void readNulSeparatedList(std::istream& input, const std::function<void(const DiscoveredFile&)>& onFile);
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace arma3 {
+
+struct WatchEvent {
+    enum class Kind {
+        Changed,  // written and closed, or moved/created in place
+        Removed,  // deleted or moved out
+        Rescan    // the kernel queue overflowed; events were lost below `path`
+    };
+
+    Kind kind;
+    std::string path;  // '/'-separated
+};
+
+// Recursive directory watcher (inotify; Linux only). Directories are walked
+// once when the watcher starts, again when one is created or moved in, and
+// by rescan() after the event queue overflowed. File events are debounced:
+// a path is reported once it has been quiet for `debounce`, so an editor's
+// save burst (truncate, write, rename, ...) yields a single Changed event
+// with the final state.
+class FileWatcher {
+public:
+    FileWatcher(const std::string& root, std::chrono::milliseconds debounce);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Block until debounced events are ready (appended to `events`) or
+    // wake() is called. Returns false once interrupt() has been called
+    bool wait(std::vector<WatchEvent>& events);
+
+    // Make a blocked wait() return; both are async-signal-safe
+    void wake();
+    void interrupt();
+
+    // Re-walk the tree after a Rescan event: directories created while events
+    // were lost get their watch, and watches on vanished ones are dropped.
+    // Call from the thread that calls wait()
+    void rescan();
+
+    size_t watchedDirectories() const { return directories.size(); }
+
+private:
+    void addTree(const std::string& directory, bool reportFiles);
+    void removeTree(const std::string& directory);
+    void readEvents();
+    void touch(const std::string& path, WatchEvent::Kind kind);
+
+    using Clock = std::chrono::steady_clock;
+    struct Pending {
+        WatchEvent::Kind kind;
+        Clock::time_point due;
+    };
+
+    std::string root;
+    std::chrono::milliseconds debounce;
+    int inotifyFd = -1;
+    int wakePipe[2] = {-1, -1};
+    std::atomic<bool> interrupted{false};
+
+    std::unordered_map<int, std::string> directories;  // watch descriptor -> path
+    std::map<std::string, Pending> pending;
+    bool overflowed = false;
+};
+
+} // namespace arma3
\ No newline at end of file
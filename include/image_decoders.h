@@ -0,0 +1,22 @@
+#pragma once
+
+#include "image_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arma3 {
+
+// The decoders behind ImageDecoder::Native. Both write RGBA straight into
+// image.data (reused when big enough, else swapped for one from the
+// thread's buffer pool), return false for input they don't handle and
+// throw std::runtime_error on corrupt data.
+
+// Any PNG libpng reads: palette, grey, tRNS and 16-bit are expanded or
+// stripped by libpng's row transforms while decoding, not in a second pass
+bool decodePNGNative(const uint8_t* data, size_t size, ImageData& image);
+
+// Uncompressed and RLE true-colour (24/32-bit) and greyscale (8-bit) TGA
+bool decodeTGANative(const uint8_t* data, size_t size, ImageData& image);
+
+} // namespace arma3
\ No newline at end of file
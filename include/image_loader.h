@@ -12,6 +12,17 @@ struct ImageData {
     std::vector<uint8_t> data; // RGBA format
 };
 
+// Which code decodes source images. Native reads PNG with libpng straight
+// into the output buffer and TGA with a built-in reader; anything either
+// can't handle (JPG, paletted TGA, ...) still goes through stb_image
+enum class ImageDecoder {
+    Stb,
+    Native
+};
+
+const char* imageDecoderName(ImageDecoder decoder);
+ImageDecoder parseImageDecoder(const std::string& name);
+
 class ImageLoader {
 public:
     // Load PNG file
@@ -23,6 +34,27 @@ public:
     // Auto-detect and load
     static ImageData load(const std::string& filename);
 
+    // Decode an encoded file already in memory; name picks the TGA reader
+    // (by extension) and is used in errors
+    static ImageData loadFromMemory(const uint8_t* data, size_t size, const std::string& name);
+
+    // Same, decoding into `image` and reusing its buffer when it is big enough.
+    // Otherwise the buffer comes from the thread's pool (buffer_pool.h)
+    static void decodeInto(const uint8_t* data, size_t size, const std::string& name, ImageData& image);
+
+    // Process-wide backend used by every load; Native by default
+    static void setDecoder(ImageDecoder decoder);
+    static ImageDecoder decoder();
+
+    // Read only the header; false if the format is not recognised
+    static bool readDimensions(const std::string& filename, uint32_t& width, uint32_t& height);
+
+    // Load and shrink so the longer side is at most maxSize (for previews)
+    static ImageData loadThumbnail(const std::string& filename, uint32_t maxSize);
+
+    // Area-average downscale so the longer side is at most maxSize
+    static ImageData downscale(const ImageData& image, uint32_t maxSize);
+
     // Save PNG file
     static void savePNG(const std::string& filename, const ImageData& image);
 
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "stage_timer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace arma3 {
+
+// Why a conversion failed, from the stage it was in
+enum class FailureCause {
+    Read,
+    Decode,
+    Encode,     // mips or DXT compression
+    Write,
+    Cancelled,
+    Other,      // before the first stage (output directory, manifest, ...)
+    Count
+};
+
+const char* failureCauseName(FailureCause cause);
+
+// Stage::Count (no stage entered yet) maps to Other
+FailureCause failureCauseFor(Stage stage);
+
+// One finished conversion
+struct ConversionSample {
+    uint64_t pixels = 0;        // top mip as loaded
+    uint64_t bytesWritten = 0;
+    double seconds = 0.0;       // whole job
+    StageTimes stages;          // stages with 0 ms are not observed
+};
+
+// Process-wide conversion metrics. Every thread records into its own
+// cache-line-aligned shard with relaxed load/store pairs: no locks, no
+// locked instructions and no cache lines shared with other workers. Only
+// a snapshot walks the shards
+void recordConversion(const ConversionSample& sample);
+void recordFailure(FailureCause cause);
+void recordUpToDate();
+
+// Marks the calling thread as a busy worker while alive. Feeds the busy
+// worker gauge and the busy-seconds counter behind worker utilization
+class WorkerBusyScope {
+public:
+    WorkerBusyScope();
+    ~WorkerBusyScope();
+
+    WorkerBusyScope(const WorkerBusyScope&) = delete;
+    WorkerBusyScope& operator=(const WorkerBusyScope&) = delete;
+};
+
+// Latency histogram with fixed bucket bounds, in seconds
+struct LatencyHistogram {
+    static constexpr size_t BoundCount = 15;
+    static const double bounds[BoundCount];
+
+    uint64_t buckets[BoundCount + 1] = {};  // per bucket (not cumulative); last is +Inf
+    double sum = 0.0;
+    uint64_t count = 0;
+};
+
+// Supplied by the owner of the work queue when a snapshot is exported
+struct MetricsGauges {
+    size_t queueDepth = 0;  // tasks waiting for a worker
+    size_t workers = 0;
+};
+
+struct MetricsSnapshot {
+    uint64_t converted = 0;
+    uint64_t upToDate = 0;
+    uint64_t failed[static_cast<size_t>(FailureCause::Count)] = {};
+    uint64_t pixels = 0;
+    uint64_t bytesWritten = 0;
+    LatencyHistogram stages[static_cast<size_t>(Stage::Count)];
+    LatencyHistogram files;
+    uint64_t busyWorkers = 0;
+    double busySeconds = 0.0;  // includes jobs still running
+    MetricsGauges gauges;
+    double utilization = 0.0;  // busy share of the workers since the previous export
+};
+
+MetricsSnapshot snapshotMetrics();
+
+// Prometheus text exposition format, metric names prefixed "arma3paa_"
+std::string metricsToPrometheus(const MetricsSnapshot& snapshot);
+
+// Parses a --metrics-interval value in seconds. Throws std::runtime_error
+// for anything that isn't a number from 0.1 to 86400 (a day): zero would
+// rewrite the file in a busy loop
+std::chrono::milliseconds parseMetricsInterval(const std::string& seconds);
+
+// Rewrites `path` with the current metrics every `interval` on its own
+// thread, and once more when destroyed. Each write goes to a temporary
+// file renamed into place, so node_exporter's textfile collector (or any
+// other scraper) never reads a partial file
+class MetricsExporter {
+public:
+    MetricsExporter(std::string path, std::chrono::milliseconds interval,
+                    std::function<MetricsGauges()> gauges);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void writeNow();
+
+private:
+    void loop();
+
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::function<MetricsGauges()> gauges;
+
+    std::mutex mutex;  // exporter state only; never taken by recording threads
+    std::condition_variable wake;
+    bool stopping = false;
+    double lastBusySeconds = 0.0;
+    std::chrono::steady_clock::time_point lastExport;
+    std::thread thread;
+};
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "image_loader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+enum class MipFilter {
+    Box,      // 2x2 average in stored (sRGB) values; the historical default
+    Kaiser,   // Kaiser-windowed sinc, width 3, alpha 4
+    Lanczos   // Lanczos-3
+};
+
+const char* mipFilterName(MipFilter filter);
+MipFilter parseMipFilter(const std::string& name);
+
+struct MipChainOptions {
+    MipFilter filter = MipFilter::Box;
+    bool linearLight = true;     // Kaiser/Lanczos: filter RGB in linear light
+    float alphaCoverage = 0.0f;  // alpha-test cutoff (0..1) whose coverage every level keeps; 0 = off
+    uint32_t skipLevels = 0;     // generated only as a source for smaller levels
+    uint32_t minSize = 4;        // stop once the shorter side is at or below this
+};
+
+// Full mip chain, largest kept level first. A skip past the end of the
+// chain still returns its smallest level.
+std::vector<ImageData> buildMipChain(ImageData top, const MipChainOptions& options);
+
+// Halve both dimensions with a 2x2 box filter; an odd last row or column is
+// dropped. SSE2 where available, bit-identical to the scalar path.
+ImageData downsampleBox(const ImageData& image);
+
+// Halve both dimensions with a separable 12-tap Kaiser or Lanczos kernel.
+// Rows are filtered in bands on a shared pool; pixels are SIMD (4 channels)
+ImageData downsampleFiltered(const ImageData& image, MipFilter filter, bool linearLight);
+
+// Fraction of pixels whose alpha exceeds cutoff * 255
+float alphaCoverage(const ImageData& image, float cutoff);
+
+// Scale alpha so that alphaCoverage(image, cutoff) comes as close as
+// possible to `coverage` (alpha-tested foliage keeps its density in mips)
+void scaleAlphaToCoverage(ImageData& image, float cutoff, float coverage);
+
+// How many halvings bring the longer side down to maxSize or below
+// (0 when maxSize is 0 or already satisfied)
+uint32_t levelsAboveSize(uint32_t width, uint32_t height, uint32_t maxSize);
+
+} // namespace arma3
\ No newline at end of file
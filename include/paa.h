@@ -4,6 +4,12 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <atomic>
+#include <stdexcept>
+
+#include "image_loader.h"
+#include "mip_filter.h"
+#include "quality.h"
 
 namespace arma3 {
 
@@ -20,6 +26,12 @@ enum class PAAFormat {
     GRAY_ALPHA = 0x8080
 };
 
+// Human readable format name ("DXT1", "RGBA8888", ...)
+const char* formatName(PAAFormat format);
+
+// Map a stored magic number to its format; UNKNOWN if not a PAA magic
+PAAFormat formatFromMagic(uint16_t magic);
+
 struct MipMap {
     uint16_t width;
     uint16_t height;
@@ -39,20 +51,159 @@ struct Palette {
     std::vector<uint8_t> data;
 };
 
+// Headers of an in-memory PAA, parsed without copying: mip payloads point
+// into the caller's buffer and stay valid only as long as it does
+struct PAAHeaderView {
+    struct Level {
+        uint16_t width;
+        uint16_t height;
+        bool lzoCompressed;
+        const uint8_t* data;
+        uint32_t dataLength;
+    };
+
+    struct TaggEntry {
+        std::string signature;  // e.g. "GGATCGVA"
+        const uint8_t* data;
+        uint32_t dataLength;
+    };
+
+    PAAFormat format = PAAFormat::UNKNOWN;
+    bool hasAlpha = false;                // GGATGALF present
+    uint8_t averageColor[4] = {};         // GGATCGVA, as stored
+    uint8_t maxColor[4] = {};             // GGATCXAM, as stored
+    std::vector<TaggEntry> taggs;         // every TAGG, in file order
+    uint16_t paletteLength = 0;
+    std::vector<Level> mips;              // largest first
+};
+
+// Throws std::runtime_error on a malformed or truncated file
+PAAHeaderView parsePAAHeaders(const uint8_t* data, size_t size);
+
+// Bytes per 4x4 block for the block formats (DXT1-DXT5), 0 for every other
+// format. The per-format details live in paa_codec.h
+size_t dxtBlockBytes(PAAFormat format);
+
+// DXT2 and DXT4 store colour premultiplied by alpha (BC2/BC3 otherwise)
+bool isPremultipliedFormat(PAAFormat format);
+
+// Decode DXT blocks of one level straight into `rgba` (width * height * 4
+// bytes). DXT2/DXT4 come back with straight alpha
+void decodeDXTBlocks(PAAFormat format, const uint8_t* blocks, size_t size,
+                     uint32_t width, uint32_t height, uint8_t* rgba);
+
+// libsquish colour fit used for DXT encoding
+enum class EncoderTier {
+    Fast,      // range fit
+    Balanced,  // cluster fit (libsquish default)
+    Best       // iterative cluster fit
+};
+
+enum class AlphaKind {
+    Opaque,  // every pixel alpha == 255
+    Binary,  // only 0 and 255 (DXT1 punch-through is enough)
+    Full
+};
+
+// Quality targets for automatic format/tier selection
+struct AutoEncodeSettings {
+    double minPSNR = 40.0;  // dB, on RGB (and alpha when kept; RGB under alpha 0 is skipped)
+    double minSSIM = 0.0;   // 0 disables the SSIM check
+};
+
+struct AutoEncodeDecision {
+    PAAFormat format = PAAFormat::UNKNOWN;
+    EncoderTier tier = EncoderTier::Balanced;
+    AlphaKind alpha = AlphaKind::Opaque;
+    QualityMetrics quality;
+    bool metTarget = false;
+};
+
+// Mip chain generation on ingest. Levels above the limits are only ever
+// downsampled, never DXT-encoded
+struct MipSettings {
+    uint32_t maxSize = 0;   // longest side of the top level (0 = unlimited)
+    uint32_t dropMips = 0;  // always drop at least this many top levels
+    MipFilter filter = MipFilter::Box;
+    bool linearLight = true;     // Kaiser/Lanczos filter RGB in linear light
+    float alphaCoverage = 0.0f;  // alpha-test cutoff whose coverage is preserved (0 = off)
+};
+
+// Container-level edits applied by PAA::repack; DXT payloads are never touched
+enum class LZOMode {
+    Keep,
+    Compress,   // LZO-compress levels wider than 128, like the encoder
+    Decompress
+};
+
+struct RepackOptions {
+    LZOMode lzo = LZOMode::Keep;
+    uint32_t dropMips = 0;                 // remove this many top levels
+    std::vector<Tagg> setTaggs;            // added, or replacing one with the same signature
+    std::vector<std::string> removeTaggs;  // signatures to drop
+};
+
+// Shared between a running conversion and an observer thread (e.g. the GUI).
+// The encoder polls `cancelled` once per block row and adds the source bytes
+// of every finished block row to `bytesProcessed`.
+struct ConversionProgress {
+    std::atomic<bool> cancelled{false};
+    std::atomic<uint64_t> bytesProcessed{0};
+    std::atomic<uint64_t> bytesTotal{0};
+};
+
+class ConversionCancelled : public std::runtime_error {
+public:
+    ConversionCancelled() : std::runtime_error("Conversion cancelled") {}
+};
+
 class PAA {
 public:
     PAA();
     explicit PAA(const std::string& filename);
     explicit PAA(const std::vector<uint8_t>& data);
 
-    // Read existing PAA file
-    void readPAA();
+    // Hands the mip buffers back to the thread's buffer pool (if it has one),
+    // so the next PAA built on a batch worker reuses them
+    ~PAA();
+    PAA(const PAA&) = default;
+    PAA(PAA&&) = default;
+    PAA& operator=(const PAA&) = default;
+    PAA& operator=(PAA&&) = default;
+
+    // Read existing PAA file. With decodeBlocks == false the mip payloads
+    // are kept exactly as stored (DXT blocks, LZO included) and decoded on demand
+    void readPAA(bool decodeBlocks = true);
+
+    // Decode a single mip level to RGBA without touching the others
+    ImageData decodeMipMap(size_t level) const;
+
+    // Smallest mip whose longer side is still >= minSize (or the largest mip)
+    size_t findMipForSize(uint32_t minSize) const;
 
     // Load image from file (PNG, TGA, etc.)
     void loadImage(const std::string& filename);
 
-    // Write PAA file
-    void writePAA(const std::string& filename, PAAFormat format = PAAFormat::UNKNOWN);
+    // Use an already decoded RGBA image as the top mip
+    void loadImage(ImageData image);
+
+    // Write PAA file. With atomicReplace the file is written under a
+    // temporary name and renamed over `filename` once complete
+    void writePAA(const std::string& filename, PAAFormat format = PAAFormat::UNKNOWN,
+                  bool atomicReplace = false);
+
+    // Encode and write PAA to any stream
+    void writePAA(std::ostream& out, PAAFormat format = PAAFormat::UNKNOWN);
+
+    // Encode to an exactly sized in-memory PAA file
+    std::vector<uint8_t> encodePAA(PAAFormat format = PAAFormat::UNKNOWN);
+
+    // Encode into a caller-owned buffer. Returns the encoded size; nothing
+    // is written when it exceeds `capacity`
+    size_t encodePAA(uint8_t* out, size_t capacity, PAAFormat format = PAAFormat::UNKNOWN);
+
+    // Upper bound on encodePAA's size for a width x height top level
+    static size_t maxEncodedSize(uint32_t width, uint32_t height);
 
     // Write image file (PNG)
     void writeImage(const std::string& filename, int mipLevel = 0);
@@ -63,23 +214,52 @@ public:
     // Set pixel data
     void setRawPixelData(const std::vector<uint8_t>& data, uint8_t level = 0);
 
+    // Must be set before loadImage, which builds the mip chain
+    void setMipSettings(const MipSettings& settings) { mipSettings = settings; }
+    const MipSettings& getMipSettings() const { return mipSettings; }
+
+    void setEncoderTier(EncoderTier tier) { encoderTier = tier; }
+    EncoderTier getEncoderTier() const { return encoderTier; }
+
+    // Try the cheapest format/tier combinations first on a representative
+    // mip and keep the first one that meets the settings. The chosen tier is
+    // applied to this PAA; pass decision.format on to writePAA
+    AutoEncodeDecision chooseEncoding(const AutoEncodeSettings& settings);
+
+    // Rewrite the container of a PAA read with readPAA(false): drop top
+    // levels, toggle LZO and edit TAGGs. The next writePAA keeps every DXT
+    // payload bit-identical and only rebuilds headers and GGATSFFO
+    void repack(const RepackOptions& options);
+
+    // Attach progress/cancellation state; must outlive the next writePAA call
+    void setProgress(ConversionProgress* progressState) { progress = progressState; }
+
     // Getters
     PAAFormat getFormat() const { return format; }
     const std::vector<MipMap>& getMipMaps() const { return mipMaps; }
     bool hasAlpha() const { return hasTransparency; }
+    bool isDecoded() const { return mipsDecoded; }
 
 private:
+    struct Serialized;  // output layout, see paa.cpp
+
     void calculateMipmapsAndTaggs();
-    void compressDXT1(MipMap& mipmap);
-    void compressDXT5(MipMap& mipmap);
-    void decompressDXT1(MipMap& mipmap);
-    void decompressDXT5(MipMap& mipmap);
+    std::vector<MipMap> encodeMipMaps(PAAFormat targetFormat);
+    Serialized serialize(PAAFormat targetFormat);
+    // Codec is a PAACodec<format> (paa_codec.h); callers dispatch once
+    template <typename Codec> void compressLevel(const MipMap& source, MipMap& encoded);
+    template <typename Codec> void decompressLevel(MipMap& mipmap) const;
+    int tierFlags() const;
+    AlphaKind classifyAlpha() const;
     void compressLZO(MipMap& mipmap);
-    void decompressLZO(MipMap& mipmap);
+    void decompressLZO(MipMap& mipmap) const;
 
     PAAFormat format = PAAFormat::DXT5;
     uint16_t magicNumber = 0xFF05;
     bool hasTransparency = false;
+    bool mipsDecoded = true;
+    EncoderTier encoderTier = EncoderTier::Balanced;
+    MipSettings mipSettings;
 
     std::vector<MipMap> mipMaps;
     std::vector<Tagg> taggs;
@@ -92,6 +272,7 @@ private:
     uint32_t averageAlpha = 0;
 
     std::shared_ptr<std::istream> inputStream;
+    ConversionProgress* progress = nullptr;
 };
 
 } // namespace arma3
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "paa.h"
+
+#include <squish.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace arma3 {
+
+// How a block format stores alpha
+enum class AlphaEncoding {
+    PunchThrough,  // DXT1: 1 bit, folded into the colour block
+    Explicit,      // DXT2/DXT3: 4 bits per pixel
+    Interpolated   // DXT4/DXT5: two endpoints and 3-bit indices
+};
+
+// Compile-time description of one PAA pixel format: block geometry, alpha
+// handling and the per-block kernels. Only formats with a specialisation
+// can be encoded or decoded; the level loops below are instantiated once
+// per codec, so nothing inside them branches on the format.
+template <PAAFormat Format>
+struct PAACodec;
+
+namespace codec_detail {
+
+inline void premultiply(uint8_t* rgba, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, rgba += 4) {
+        uint32_t a = rgba[3];
+        if (a == 255) continue;
+        rgba[0] = static_cast<uint8_t>((rgba[0] * a + 127) / 255);
+        rgba[1] = static_cast<uint8_t>((rgba[1] * a + 127) / 255);
+        rgba[2] = static_cast<uint8_t>((rgba[2] * a + 127) / 255);
+    }
+}
+
+inline void unpremultiply(uint8_t* rgba, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, rgba += 4) {
+        uint32_t a = rgba[3];
+        if (a == 255) continue;
+        if (a == 0) {
+            rgba[0] = rgba[1] = rgba[2] = 0;
+            continue;
+        }
+        // Block compression can leave colour slightly above alpha
+        rgba[0] = static_cast<uint8_t>(std::min<uint32_t>(255, (rgba[0] * 255 + a / 2) / a));
+        rgba[1] = static_cast<uint8_t>(std::min<uint32_t>(255, (rgba[1] * 255 + a / 2) / a));
+        rgba[2] = static_cast<uint8_t>(std::min<uint32_t>(255, (rgba[2] * 255 + a / 2) / a));
+    }
+}
+
+// The five DXT formats differ only in these parameters
+template <PAAFormat Format, int SquishFlags, size_t BlockBytes, AlphaEncoding Alpha, bool Premultiplied>
+struct DXTCodec {
+    static constexpr PAAFormat format = Format;
+    static constexpr uint32_t blockSize = 4;               // pixels per block side
+    static constexpr size_t bytesPerBlock = BlockBytes;
+    static constexpr AlphaEncoding alpha = Alpha;
+    static constexpr bool premultiplied = Premultiplied;  // colour stored multiplied by alpha
+    static constexpr int squishFlags = SquishFlags;
+
+    // 16 RGBA pixels, row-major. Bit 4 * y + x of `mask` is set for pixels
+    // inside the image; the others are ignored. `fitFlags` picks the
+    // libsquish colour fit
+    static void encodeBlock(const uint8_t* rgba, int mask, int fitFlags, uint8_t* block) {
+        if constexpr (Premultiplied) {
+            uint8_t scaled[64];
+            std::memcpy(scaled, rgba, sizeof(scaled));
+            premultiply(scaled, 16);
+            squish::CompressMasked(scaled, mask, block, SquishFlags | fitFlags);
+        } else {
+            squish::CompressMasked(rgba, mask, block, SquishFlags | fitFlags);
+        }
+    }
+
+    // Always straight alpha out
+    static void decodeBlock(const uint8_t* block, uint8_t* rgba) {
+        squish::Decompress(rgba, block, SquishFlags);
+        if constexpr (Premultiplied) {
+            unpremultiply(rgba, 16);
+        }
+    }
+};
+
+} // namespace codec_detail
+
+// BC1
+template <>
+struct PAACodec<PAAFormat::DXT1>
+    : codec_detail::DXTCodec<PAAFormat::DXT1, squish::kDxt1, 8, AlphaEncoding::PunchThrough, false> {};
+
+// BC2, premultiplied
+template <>
+struct PAACodec<PAAFormat::DXT2>
+    : codec_detail::DXTCodec<PAAFormat::DXT2, squish::kDxt3, 16, AlphaEncoding::Explicit, true> {};
+
+// BC2
+template <>
+struct PAACodec<PAAFormat::DXT3>
+    : codec_detail::DXTCodec<PAAFormat::DXT3, squish::kDxt3, 16, AlphaEncoding::Explicit, false> {};
+
+// BC3, premultiplied
+template <>
+struct PAACodec<PAAFormat::DXT4>
+    : codec_detail::DXTCodec<PAAFormat::DXT4, squish::kDxt5, 16, AlphaEncoding::Interpolated, true> {};
+
+// BC3
+template <>
+struct PAACodec<PAAFormat::DXT5>
+    : codec_detail::DXTCodec<PAAFormat::DXT5, squish::kDxt5, 16, AlphaEncoding::Interpolated, false> {};
+
+template <PAAFormat... Formats>
+struct CodecList {};
+
+// Every format with a codec. A new format is a PAACodec specialisation
+// plus an entry here; dispatch, hasCodec and the level loops pick it up
+using RegisteredCodecs = CodecList<
+    PAAFormat::DXT1,
+    PAAFormat::DXT2,
+    PAAFormat::DXT3,
+    PAAFormat::DXT4,
+    PAAFormat::DXT5
+>;
+
+namespace codec_detail {
+
+template <PAAFormat... Formats>
+constexpr bool listed(PAAFormat format, CodecList<Formats...>) {
+    return ((format == Formats) || ...);
+}
+
+template <typename Fn, PAAFormat First, PAAFormat... Rest>
+decltype(auto) dispatch(PAAFormat format, Fn&& fn, CodecList<First, Rest...>) {
+    if (format == First) {
+        return fn(PAACodec<First>{});
+    }
+    if constexpr (sizeof...(Rest) > 0) {
+        return dispatch(format, std::forward<Fn>(fn), CodecList<Rest...>{});
+    } else {
+        throw std::runtime_error(std::string("No codec for PAA format ") + formatName(format));
+    }
+}
+
+} // namespace codec_detail
+
+constexpr bool hasCodec(PAAFormat format) {
+    return codec_detail::listed(format, RegisteredCodecs{});
+}
+
+// Call fn(PAACodec<format>{}) for a format known only at run time. Do this
+// once per file or level and run the specialised loops inside `fn`. Every
+// instantiation of `fn` must return the same type. Throws
+// std::runtime_error if the format has no codec
+template <typename Fn>
+decltype(auto) dispatchCodec(PAAFormat format, Fn&& fn) {
+    return codec_detail::dispatch(format, std::forward<Fn>(fn), RegisteredCodecs{});
+}
+
+// Encode block row `blockRow` of a width x height RGBA level into
+// ceil(width / 4) consecutive blocks. Edge blocks are masked, as
+// squish::CompressImage does
+template <typename Codec>
+void encodeBlockRow(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockRow,
+                    int fitFlags, uint8_t* blocks) {
+    constexpr uint32_t B = Codec::blockSize;
+    const uint32_t y0 = blockRow * B;
+    const uint32_t rows = std::min(B, height - y0);
+    uint8_t pixels[B * B * 4] = {};
+
+    for (uint32_t x0 = 0; x0 < width; x0 += B, blocks += Codec::bytesPerBlock) {
+        const uint32_t columns = std::min(B, width - x0);
+        int mask = 0;
+        for (uint32_t py = 0; py < rows; py++) {
+            std::memcpy(pixels + py * B * 4, rgba + ((static_cast<size_t>(y0) + py) * width + x0) * 4, columns * 4);
+            mask |= ((1 << columns) - 1) << (py * B);
+        }
+        Codec::encodeBlock(pixels, mask, fitFlags, blocks);
+    }
+}
+
+// Decode a whole level into width * height * 4 bytes of RGBA. The caller
+// checks that `blocks` holds every block
+template <typename Codec>
+void decodeLevel(const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba) {
+    constexpr uint32_t B = Codec::blockSize;
+    uint8_t pixels[B * B * 4];
+
+    for (uint32_t y0 = 0; y0 < height; y0 += B) {
+        const uint32_t rows = std::min(B, height - y0);
+        for (uint32_t x0 = 0; x0 < width; x0 += B, blocks += Codec::bytesPerBlock) {
+            const uint32_t columns = std::min(B, width - x0);
+            Codec::decodeBlock(blocks, pixels);
+            for (uint32_t py = 0; py < rows; py++) {
+                std::memcpy(rgba + ((static_cast<size_t>(y0) + py) * width + x0) * 4, pixels + py * B * 4, columns * 4);
+            }
+        }
+    }
+}
+
+// Bytes of block data in a width x height level
+template <typename Codec>
+constexpr size_t levelBytes(uint32_t width, uint32_t height) {
+    constexpr uint32_t B = Codec::blockSize;
+    return static_cast<size_t>((width + B - 1) / B) * ((height + B - 1) / B) * Codec::bytesPerBlock;
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "paa.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+struct DiffOptions {
+    bool decodeBlocks = true;  // decode differing blocks for error metrics and regions
+    size_t maxRegions = 8;     // changed regions listed per mip (largest first)
+    double minPSNR = std::numeric_limits<double>::infinity();  // changes at or above this don't count
+};
+
+// Bounding box, in pixels, of one group of touching changed blocks
+struct DiffRegion {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t blocks = 0;
+};
+
+// One mip size present in either file. Levels are paired by dimensions,
+// so a dropped top mip shows up as one removed level, not as every level
+// changing
+struct MipDiff {
+    uint16_t width = 0;
+    uint16_t height = 0;
+    int levelA = -1;             // index in each file; -1 if the level is absent
+    int levelB = -1;
+    bool bytesOnly = false;      // LZO payload or a format without a codec: compared as bytes
+    bool payloadChanged = false;
+    uint64_t blocks = 0;
+    uint64_t changedBlocks = 0;  // block bytes differ
+    uint64_t visibleBlocks = 0;  // decoded pixels differ (with decodeBlocks)
+    uint32_t maxDelta = 0;       // largest difference in any channel, 0..255
+    double psnr = std::numeric_limits<double>::infinity();  // whole level, RGBA
+    std::vector<DiffRegion> regions;
+};
+
+struct PAADiff {
+    std::string pathA;
+    std::string pathB;
+    std::string error;           // unreadable or corrupt input; nothing else is filled
+    bool identical = false;      // byte-for-byte
+    PAAFormat formatA = PAAFormat::UNKNOWN;
+    PAAFormat formatB = PAAFormat::UNKNOWN;
+    std::vector<std::string> headerChanges;  // format, TAGGs (except GGATSFFO), palette
+    std::vector<MipDiff> mips;   // levels of A largest first, then levels only in B
+
+    // Set for errors, header or TAGG edits, added or removed levels,
+    // byte-compared payload changes and visible changes below minPSNR.
+    // Without decodeBlocks any changed block counts
+    bool significant = false;
+};
+
+// Compare two PAA files without decoding unchanged data. Headers and
+// TAGGs are compared field by field. Each level's DXT payload is compared
+// block by block, in large memcmp strides, then SSE2 per block. Only
+// blocks whose bytes differ are decoded. With different formats, every
+// block is decoded and compared as pixels.
+PAADiff diffPAAFiles(const std::string& pathA, const std::string& pathB, const DiffOptions& options = {});
+
+PAADiff diffPAABuffers(const uint8_t* a, size_t sizeA, const uint8_t* b, size_t sizeB,
+                       const DiffOptions& options = {});
+
+// One JSON object per diff, suitable for JSON Lines output
+std::string paaDiffToJSON(const PAADiff& diff);
+
+} // namespace arma3
\ No newline at end of file
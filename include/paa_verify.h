@@ -0,0 +1,44 @@
+#pragma once
+
+#include "paa.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+struct VerifyOptions {
+    bool decodeLevels = false;  // also run every DXT level through the decoder
+};
+
+struct VerifyReport {
+    std::string path;
+    bool ok = true;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    PAAFormat format = PAAFormat::UNKNOWN;
+    uint64_t fileSize = 0;
+    size_t mipCount = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    void fail(const std::string& message) {
+        ok = false;
+        errors.push_back(message);
+    }
+};
+
+// Structural validation of a PAA file: magic, TAGGs, GGATSFFO offsets
+// against the real mip positions, mip dimension chain and payload sizes.
+// Without decodeLevels only headers are read (payloads are seeked over),
+// so a verify pass costs a few KB of I/O per file.
+VerifyReport verifyPAAFile(const std::string& path, const VerifyOptions& options = {});
+
+// Same checks on an in-memory file
+VerifyReport verifyPAABuffer(const uint8_t* data, size_t size, const VerifyOptions& options = {});
+
+// One JSON object per report, suitable for JSON Lines output
+std::string verifyReportToJSON(const VerifyReport& report);
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arma3 {
+
+struct QualityMetrics {
+    double mse = 0.0;
+    double rmse = 0.0;
+    double psnr = 0.0;   // dB; capped at 99 for identical images
+    double ssim = -1.0;  // -1 when not computed
+};
+
+// Compare two RGBA images of identical dimensions. The squared-error pass
+// is SIMD (SSE2 where available); SSIM is computed on luma over 8x8 windows
+// and only when requested, since it is several times more expensive.
+// With includeAlpha, the colour of texels with alpha 0 in `reference` is
+// not compared: it is invisible, and DXT1 punch-through stores it as black
+QualityMetrics measureQuality(const uint8_t* reference, const uint8_t* test,
+                              uint32_t width, uint32_t height,
+                              bool includeAlpha, bool computeSSIM = false);
+
+// Sum of squared differences over `pixels` RGBA pixels. With includeAlpha,
+// RGB is skipped where `a` (the reference) has alpha 0
+uint64_t sumSquaredError(const uint8_t* a, const uint8_t* b, size_t pixels, bool includeAlpha);
+
+// Luma SSIM. With maskTransparent, texels with alpha 0 in `reference`
+// count as black in both images
+double computeSSIM(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height,
+                   bool maskTransparent = false);
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+struct ShardItem {
+    std::string path;     // as seen by every node, '/'-separated
+    uint64_t weight = 1;  // estimated work, e.g. pixel count
+};
+
+// Parse "i/N" (0-based index); throws on malformed input
+void parseShardSpec(const std::string& spec, uint32_t& index, uint32_t& count);
+
+// Deterministic weighted partition. Every node that sees the same file set
+// computes the same assignment: items are ordered by weight, then by a
+// stable path hash, and each one goes to the least loaded shard so far
+// (lowest index on ties). Returns the items owned by `shardIndex`.
+std::vector<ShardItem> selectShard(std::vector<ShardItem> items, uint32_t shardIndex, uint32_t shardCount);
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace arma3 {
+
+// Pipeline stages of one conversion
+enum class Stage {
+    Read,    // waiting for the source file (async I/O)
+    Decode,  // PNG/TGA decode; includes the file read without async I/O
+    Mips,    // mip chain generation
+    Encode,  // DXT compression and container layout
+    Write,   // output file write
+    Count
+};
+
+const char* stageName(Stage stage);
+
+struct StageTimes {
+    double ms[static_cast<size_t>(Stage::Count)] = {};
+
+    double& operator[](Stage stage) { return ms[static_cast<size_t>(stage)]; }
+    double operator[](Stage stage) const { return ms[static_cast<size_t>(stage)]; }
+};
+
+// Routes every StageScope on this thread into `times` while alive
+class StageRecorder {
+public:
+    explicit StageRecorder(StageTimes& times);
+    ~StageRecorder();
+
+    StageRecorder(const StageRecorder&) = delete;
+    StageRecorder& operator=(const StageRecorder&) = delete;
+
+    // Most recently entered stage (Stage::Count before the first); after an
+    // exception, the stage it most likely came from
+    Stage lastStage() const { return last; }
+
+private:
+    friend class StageScope;
+
+    StageTimes* times;
+    StageRecorder* previous;
+    Stage last = Stage::Count;
+};
+
+// Adds its lifetime to `stage` of the active recorder; without a recorder
+// on this thread it does nothing (not even read the clock)
+class StageScope {
+public:
+    explicit StageScope(Stage stage);
+    ~StageScope();
+
+    StageScope(const StageScope&) = delete;
+    StageScope& operator=(const StageScope&) = delete;
+
+private:
+    StageRecorder* recorder;
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace arma3
\ No newline at end of file
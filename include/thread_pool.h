@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace arma3 {
+
+// Fixed-size worker pool shared by all conversions in a process
+class ThreadPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread. With pinWorkers
+    // each worker is bound to one CPU (CpuTopology::placement), so a task
+    // and the memory it first touches stay on one NUMA node
+    explicit ThreadPool(size_t threadCount = 0, bool pinWorkers = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task; it runs on the first idle worker
+    void submit(std::function<void()> task);
+
+    // Block until the queue is empty and every worker is idle
+    void wait();
+
+    size_t size() const { return workers.size(); }
+    bool pinned() const { return pinnedWorkers; }
+    size_t pendingTasks() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+
+    mutable std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allIdle;
+    size_t activeTasks = 0;
+    bool stopping = false;
+    bool pinnedWorkers = false;
+};
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "image_loader.h"
+#include "paa.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace arma3 {
+
+enum class ThumbnailSource {
+    Image,  // PNG/TGA/JPG input
+    PAA     // Converted output
+};
+
+struct Thumbnail {
+    unsigned int texture = 0;  // 0 when the file could not be previewed
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Decodes previews on background threads and turns them into OpenGL
+// textures on the render thread. Textures are kept in an LRU list that is
+// trimmed to a byte budget, so scrolling long file lists stays smooth.
+// All public members must be called from the thread owning the GL context.
+class ThumbnailCache {
+public:
+    // Must be constructed with the GL context current (queries S3TC support)
+    ThumbnailCache(size_t byteBudget, uint32_t thumbnailSize, size_t decodeThreads = 2);
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // nullptr while the preview is still being decoded. A failed preview
+    // (texture 0) is decoded again once it is a couple of seconds old
+    const Thumbnail* request(const std::string& path, ThumbnailSource source);
+
+    // Forget a preview, e.g. after the PAA has been rewritten
+    void invalidate(const std::string& path, ThumbnailSource source);
+
+    // Upload at most maxUploads finished decodes; call once per frame
+    void processUploads(size_t maxUploads = 8);
+
+    size_t bytesUsed() const { return usedBytes; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        std::string key;
+        Thumbnail thumbnail;
+        size_t bytes = 0;
+        uint64_t retryFrame = 0;  // failed previews only: frame after which request() decodes again
+    };
+
+    struct PendingRequest {
+        uint64_t ticket = 0;
+        uint64_t lastFrame = 0;
+    };
+
+    // Either RGBA pixels, or a still-compressed DXT mip chain for GPUs
+    // that sample S3TC natively (compressedFormat != UNKNOWN)
+    struct Decoded {
+        std::string key;
+        uint64_t ticket = 0;
+        bool ok = false;
+        ImageData image;
+        PAAFormat compressedFormat = PAAFormat::UNKNOWN;
+        std::vector<MipMap> compressedMips;
+    };
+
+    static std::string makeKey(const std::string& path, ThumbnailSource source);
+
+    void decode(const std::string& key, const std::string& path, ThumbnailSource source, uint64_t ticket);
+    void uploadRGBA(Thumbnail& thumbnail, const ImageData& image);
+    size_t uploadCompressed(Thumbnail& thumbnail, PAAFormat format, const std::vector<MipMap>& mips);
+    void insert(const std::string& key, const Thumbnail& thumbnail, size_t bytes);
+    void evictToBudget();
+
+    size_t budget;
+    uint32_t thumbSize;
+    bool s3tcSupported = false;  // set once on the render thread, read-only afterwards
+    size_t usedBytes = 0;
+
+    // Render thread only; front is most recently used
+    std::list<Entry> lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+
+    // Shared with the decode threads
+    std::mutex mutex;
+    std::unordered_map<std::string, PendingRequest> pending;
+    std::vector<Decoded> finished;
+    std::atomic<uint64_t> frame{0};
+    uint64_t nextTicket = 1;
+
+    // Declared last so workers are joined before the state above goes away
+    ThreadPool pool;
+};
+
+} // namespace arma3
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
 #include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
+#include <random>
+#include <stdexcept>
 #include <vector>
 #include <cstdint>
+#include <string>
 
 namespace arma3 {
 namespace utils {
@@ -37,6 +43,15 @@ inline uint32_t readBytesAsArmaUShort(std::istream& stream) {
     return (b3 << 16) | (b2 << 8) | b1;
 }
 
+// Total length of a seekable stream; the read position is preserved
+inline uint64_t streamLength(std::istream& stream) {
+    std::streampos pos = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    std::streampos end = stream.tellg();
+    stream.seekg(pos);
+    return end < 0 ? 0 : static_cast<uint64_t>(end);
+}
+
 template<typename T>
 T peekBytes(std::istream& stream) {
     T value;
@@ -71,5 +86,67 @@ inline void writeBytesAsArmaUShort(std::ostream& stream, uint32_t value) {
     writeBytes(stream, b3);
 }
 
+// 64-bit FNV-1a; stable across platforms and runs
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& str, uint64_t seed = 0xcbf29ce484222325ULL) {
+    return hashBytes(str.data(), str.size(), seed);
+}
+
+// Sibling of `path` for write-then-rename; unique per process and call, and
+// in the same directory so the rename never crosses filesystems
+inline std::string temporaryPathFor(const std::string& path) {
+    static const uint32_t processTag = std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), ".tmp-%08x-%llu", processTag,
+                  static_cast<unsigned long long>(counter++));
+    return path + suffix;
+}
+
+// Move a finished temporary over `path` (replacing it atomically); the
+// temporary is removed if that fails
+inline void replaceFile(const std::string& temporary, const std::string& path) {
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw std::runtime_error("Failed to replace " + path + ": " + ec.message());
+    }
+}
+
+// Escape a string for embedding in a JSON document
+inline std::string jsonEscape(const std::string& str) {
+    std::string out;
+    out.reserve(str.size() + 2);
+    for (char ch : str) {
+        switch (ch) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+                    out += buffer;
+                } else {
+                    out += ch;
+                }
+        }
+    }
+    return out;
+}
+
 } // namespace utils
 } // namespace arma3
\ No newline at end of file
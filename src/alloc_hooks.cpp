@@ -0,0 +1,64 @@
+// Global operator new/delete replacements feeding alloc_stats. Linked into
+// the CLI and benchmark only; the GUI and libarma3paa keep the default
+// allocator. While tracking is off each call costs one relaxed load.
+
+#include "alloc_stats.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define ARMA3_USABLE_SIZE(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define ARMA3_USABLE_SIZE(p) malloc_size(p)
+#elif defined(__GLIBC__) || defined(__FreeBSD__)
+#include <malloc.h>
+#define ARMA3_USABLE_SIZE(p) malloc_usable_size(p)
+#endif
+
+#ifdef ARMA3_USABLE_SIZE
+
+namespace arma3 {
+extern bool allocationHooksPresent;
+}
+
+namespace {
+
+struct HooksInstalled {
+    HooksInstalled() { arma3::allocationHooksPresent = true; }
+} hooksInstalled;
+
+} // namespace
+
+// Sizes are the allocator's usable size at both ends, so blocks allocated
+// before tracking started are still subtracted consistently
+void* operator new(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    while (!p) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+        p = std::malloc(size ? size : 1);
+    }
+    if (arma3::allocationTracking.load(std::memory_order_relaxed)) {
+        arma3::recordAllocation(ARMA3_USABLE_SIZE(p));
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p && arma3::allocationTracking.load(std::memory_order_relaxed)) {
+        arma3::recordFree(ARMA3_USABLE_SIZE(p));
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+#endif // ARMA3_USABLE_SIZE
\ No newline at end of file
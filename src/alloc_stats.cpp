@@ -0,0 +1,337 @@
+#include "alloc_stats.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace arma3 {
+
+std::atomic<bool> allocationTracking{false};
+
+// Set from alloc_hooks.cpp during static initialisation; constant-initialised
+// here, so the order between the two translation units does not matter
+bool allocationHooksPresent = false;
+
+namespace {
+
+constexpr size_t StageCount = static_cast<size_t>(MemoryStage::Count);
+
+// Counters are only written by their own thread; relaxed atomics let the
+// snapshot read them from another thread without locked instructions on
+// the allocation path
+struct RelaxedCounter {
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct ThreadState {
+    uint32_t index = 0;
+    RelaxedCounter allocations[StageCount];
+    RelaxedCounter bytes[StageCount];
+    RelaxedCounter frees;
+    RelaxedCounter files;
+    std::atomic<int64_t> live{0};
+    std::atomic<int64_t> peak{0};
+};
+
+thread_local ThreadState* threadState = nullptr;
+thread_local FileMemory* activeFile = nullptr;
+thread_local int64_t activeFileBase = 0;
+thread_local MemoryStage activeStage = MemoryStage::Other;
+thread_local bool insideHook = false;
+
+std::atomic<int64_t> liveBytes{0};
+std::atomic<int64_t> peakLiveBytes{0};
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Never freed: a thread's counters outlive it so the final report sees them
+std::vector<ThreadState*>& registry() {
+    static auto* threads = new std::vector<ThreadState*>();
+    return *threads;
+}
+
+ThreadState* currentThread() {
+    if (!threadState) {
+        void* memory = std::malloc(sizeof(ThreadState));
+        if (!memory) {
+            return nullptr;
+        }
+        ThreadState* state = new (memory) ThreadState();
+        std::lock_guard<std::mutex> lock(registryMutex());
+        state->index = static_cast<uint32_t>(registry().size());
+        registry().push_back(state);
+        threadState = state;
+    }
+    return threadState;
+}
+
+// Allocations made while the hook itself allocates (registry growth) are not counted
+struct HookGuard {
+    HookGuard() : active(!insideHook) { insideHook = true; }
+    ~HookGuard() { if (active) insideHook = false; }
+    bool active;
+};
+
+int64_t threadLive(const ThreadState* state) {
+    return state ? state->live.load(std::memory_order_relaxed) : 0;
+}
+
+double megabytes(double bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+const char* memoryStageName(MemoryStage stage) {
+    switch (stage) {
+        case MemoryStage::Decode: return "decode";
+        case MemoryStage::Mips: return "mips";
+        case MemoryStage::EncodedMips: return "encoded_mips";
+        case MemoryStage::Squish: return "squish";
+        case MemoryStage::Taggs: return "taggs";
+        case MemoryStage::Layout: return "layout";
+        default: return "other";
+    }
+}
+
+bool allocationHooksInstalled() {
+    return allocationHooksPresent;
+}
+
+void enableAllocationTracking() {
+    allocationTracking.store(true, std::memory_order_relaxed);
+}
+
+void disableAllocationTracking() {
+    allocationTracking.store(false, std::memory_order_relaxed);
+}
+
+void recordAllocation(size_t size) {
+    HookGuard guard;
+    if (!guard.active) {
+        return;
+    }
+    ThreadState* state = currentThread();
+    if (!state) {
+        return;
+    }
+
+    size_t stage = static_cast<size_t>(activeStage);
+    state->allocations[stage].add(1);
+    state->bytes[stage].add(size);
+
+    int64_t live = state->live.load(std::memory_order_relaxed) + static_cast<int64_t>(size);
+    state->live.store(live, std::memory_order_relaxed);
+    if (live > state->peak.load(std::memory_order_relaxed)) {
+        state->peak.store(live, std::memory_order_relaxed);
+    }
+
+    if (activeFile) {
+        activeFile->allocations++;
+        activeFile->bytes += size;
+        activeFile->peakBytes = std::max(activeFile->peakBytes, live - activeFileBase);
+    }
+
+    int64_t total = liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (total > peak && !peakLiveBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+}
+
+void recordFree(size_t size) {
+    HookGuard guard;
+    if (!guard.active) {
+        return;
+    }
+    ThreadState* state = currentThread();
+    if (!state) {
+        return;
+    }
+
+    // Blocks handed to another thread (e.g. async writes) are freed there,
+    // so a thread's own live count can dip below zero
+    state->frees.add(1);
+    state->live.store(state->live.load(std::memory_order_relaxed) - static_cast<int64_t>(size),
+                      std::memory_order_relaxed);
+    liveBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+MemoryStageScope::MemoryStageScope(MemoryStage stage) : previous(activeStage) {
+    activeStage = stage;
+}
+
+MemoryStageScope::~MemoryStageScope() {
+    activeStage = previous;
+}
+
+FileMemoryRecorder::FileMemoryRecorder(FileMemory& memory)
+    : previous(activeFile), startLive(activeFileBase) {
+    activeFile = &memory;
+    activeFileBase = threadLive(threadState);
+    if (allocationTracking.load(std::memory_order_relaxed)) {
+        HookGuard guard;
+        if (ThreadState* state = currentThread()) {
+            state->files.add(1);
+        }
+    }
+}
+
+FileMemoryRecorder::~FileMemoryRecorder() {
+    activeFile = previous;
+    activeFileBase = startLive;
+}
+
+AllocationSnapshot snapshotAllocations() {
+    AllocationSnapshot snapshot;
+    {
+        HookGuard guard;
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const ThreadState* state : registry()) {
+            ThreadAllocation thread;
+            thread.index = state->index;
+            thread.files = state->files.get();
+            thread.frees = state->frees.get();
+            thread.peakBytes = state->peak.load(std::memory_order_relaxed);
+            for (size_t s = 0; s < StageCount; s++) {
+                uint64_t allocations = state->allocations[s].get();
+                uint64_t bytes = state->bytes[s].get();
+                thread.total.allocations += allocations;
+                thread.total.bytes += bytes;
+                snapshot.stages[s].allocations += allocations;
+                snapshot.stages[s].bytes += bytes;
+            }
+            snapshot.threads.push_back(thread);
+        }
+    }
+    snapshot.peakLiveBytes = peakLiveBytes.load(std::memory_order_relaxed);
+    snapshot.peakResidentBytes = peakResidentSize();
+    return snapshot;
+}
+
+uint64_t peakResidentSize() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoull(line.substr(6)) * 1024;
+        }
+    }
+#endif
+#ifndef _WIN32
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void resetPeakResidentSize() {
+#ifdef __linux__
+    // "5" resets VmHWM (Linux 4.0+)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+void printAllocationStats(std::ostream& out, const AllocationSnapshot& snapshot,
+                          const std::vector<NamedFileMemory>& files) {
+    char line[256];
+
+    out << "\nMemory by stage:\n";
+    std::snprintf(line, sizeof(line), "  %-14s %12s %12s\n", "stage", "allocations", "MB");
+    out << line;
+    for (size_t s = 0; s < StageCount; s++) {
+        std::snprintf(line, sizeof(line), "  %-14s %12llu %12.1f\n", memoryStageName(static_cast<MemoryStage>(s)),
+                      static_cast<unsigned long long>(snapshot.stages[s].allocations),
+                      megabytes(snapshot.stages[s].bytes));
+        out << line;
+    }
+
+    out << "\nMemory by thread:\n";
+    std::snprintf(line, sizeof(line), "  %-8s %7s %12s %12s %12s\n", "thread", "files", "allocations", "MB", "peak MB");
+    out << line;
+    for (const auto& thread : snapshot.threads) {
+        if (thread.total.allocations == 0) continue;
+        std::snprintf(line, sizeof(line), "  %-8u %7llu %12llu %12.1f %12.1f\n", thread.index,
+                      static_cast<unsigned long long>(thread.files),
+                      static_cast<unsigned long long>(thread.total.allocations),
+                      megabytes(thread.total.bytes), megabytes(std::max<int64_t>(0, thread.peakBytes)));
+        out << line;
+    }
+
+    if (!files.empty()) {
+        out << "\nPeak live memory by file:\n";
+        std::snprintf(line, sizeof(line), "  %10s %10s %12s  %s\n", "peak MB", "MP", "allocations", "file");
+        out << line;
+        for (const auto& file : files) {
+            std::snprintf(line, sizeof(line), "  %10.1f %10.2f %12llu  ", megabytes(file.memory.peakBytes),
+                          file.pixels / 1e6, static_cast<unsigned long long>(file.memory.allocations));
+            out << line << file.path << "\n";
+        }
+    }
+
+    std::snprintf(line, sizeof(line), "\nPeak live heap: %.1f MB, peak RSS: %.1f MB\n",
+                  megabytes(snapshot.peakLiveBytes), megabytes(snapshot.peakResidentBytes));
+    out << line;
+}
+
+std::string allocationStatsToJSON(const AllocationSnapshot& snapshot,
+                                  const std::vector<NamedFileMemory>& files) {
+    std::ostringstream ss;
+    ss << "{\"peak_live_bytes\":" << snapshot.peakLiveBytes
+       << ",\"peak_rss_bytes\":" << snapshot.peakResidentBytes
+       << ",\"stages\":{";
+    for (size_t s = 0; s < StageCount; s++) {
+        ss << (s ? "," : "") << "\"" << memoryStageName(static_cast<MemoryStage>(s)) << "\":"
+           << "{\"allocations\":" << snapshot.stages[s].allocations
+           << ",\"bytes\":" << snapshot.stages[s].bytes << "}";
+    }
+    ss << "},\"threads\":[";
+    bool first = true;
+    for (const auto& thread : snapshot.threads) {
+        if (thread.total.allocations == 0) continue;
+        ss << (first ? "" : ",")
+           << "{\"thread\":" << thread.index
+           << ",\"files\":" << thread.files
+           << ",\"allocations\":" << thread.total.allocations
+           << ",\"bytes\":" << thread.total.bytes
+           << ",\"frees\":" << thread.frees
+           << ",\"peak_bytes\":" << thread.peakBytes << "}";
+        first = false;
+    }
+    ss << "],\"files\":[";
+    for (size_t i = 0; i < files.size(); i++) {
+        ss << (i ? "," : "")
+           << "{\"path\":\"" << utils::jsonEscape(files[i].path) << "\""
+           << ",\"pixels\":" << files[i].pixels
+           << ",\"allocations\":" << files[i].memory.allocations
+           << ",\"bytes\":" << files[i].memory.bytes
+           << ",\"peak_bytes\":" << files[i].memory.peakBytes << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "arma3paa.h"
+#include "paa.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+
+using namespace arma3;
+
+struct arma3paa_context {
+    explicit arma3paa_context(size_t threads) : pool(threads) {}
+
+    ThreadPool pool;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+// Thrown inside the API to return a specific status
+struct ApiError {
+    int status;
+    std::string message;
+};
+
+// Run `body` and turn anything it throws into a status code
+template<typename Body>
+int guarded(Body&& body, std::string& error) {
+    try {
+        body();
+        error.clear();
+        return ARMA3PAA_OK;
+    } catch (const ApiError& e) {
+        error = e.message;
+        return e.status;
+    } catch (const std::bad_alloc&) {
+        error = "Out of memory";
+    } catch (const std::exception& e) {
+        error = e.what();
+    } catch (...) {
+        error = "Unknown error";
+    }
+    return ARMA3PAA_ERROR_FAILED;
+}
+
+template<typename Body>
+int guarded(Body&& body) {
+    return guarded(std::forward<Body>(body), lastError);
+}
+
+// Caller options over the defaults; older, shorter structs keep the defaults
+// for fields they do not have
+arma3paa_encode_options readOptions(const arma3paa_encode_options* options) {
+    arma3paa_encode_options result;
+    arma3paa_encode_options_init(&result);
+    if (options) {
+        if (options->struct_size < sizeof(uint32_t)) {
+            throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Encode options have no struct_size"};
+        }
+        std::memcpy(&result, options, std::min<size_t>(options->struct_size, sizeof(result)));
+        result.struct_size = sizeof(result);
+    }
+    return result;
+}
+
+PAAFormat formatOption(uint32_t format) {
+    switch (format) {
+        case ARMA3PAA_FORMAT_AUTO: return PAAFormat::UNKNOWN;
+        case ARMA3PAA_FORMAT_DXT1: return PAAFormat::DXT1;
+        case ARMA3PAA_FORMAT_DXT2: return PAAFormat::DXT2;
+        case ARMA3PAA_FORMAT_DXT3: return PAAFormat::DXT3;
+        case ARMA3PAA_FORMAT_DXT4: return PAAFormat::DXT4;
+        case ARMA3PAA_FORMAT_DXT5: return PAAFormat::DXT5;
+        default:
+            throw ApiError{ARMA3PAA_ERROR_UNSUPPORTED, "Unsupported encode format: " + std::to_string(format)};
+    }
+}
+
+EncoderTier qualityOption(uint32_t quality) {
+    switch (quality) {
+        case ARMA3PAA_QUALITY_FAST: return EncoderTier::Fast;
+        case ARMA3PAA_QUALITY_BALANCED: return EncoderTier::Balanced;
+        case ARMA3PAA_QUALITY_BEST: return EncoderTier::Best;
+        default:
+            throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Unknown quality: " + std::to_string(quality)};
+    }
+}
+
+MipFilter filterOption(uint32_t filter) {
+    switch (filter) {
+        case ARMA3PAA_MIP_FILTER_BOX: return MipFilter::Box;
+        case ARMA3PAA_MIP_FILTER_KAISER: return MipFilter::Kaiser;
+        case ARMA3PAA_MIP_FILTER_LANCZOS: return MipFilter::Lanczos;
+        default:
+            throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Unknown mip filter: " + std::to_string(filter)};
+    }
+}
+
+size_t encode(const uint8_t* rgba, uint32_t width, uint32_t height,
+              const arma3paa_encode_options* callerOptions, uint8_t* out, size_t capacity) {
+    if (!rgba || width == 0 || height == 0 || width > 0x7FFF || height > 0x7FFF) {
+        throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Invalid input image"};
+    }
+    if (!out && capacity > 0) {
+        throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Output buffer is NULL"};
+    }
+
+    arma3paa_encode_options options = readOptions(callerOptions);
+    PAAFormat format = formatOption(options.format);
+
+    MipSettings mips;
+    mips.maxSize = options.max_size;
+    mips.dropMips = options.drop_mips;
+    mips.filter = filterOption(options.mip_filter);
+    mips.linearLight = options.srgb_mips == 0;
+    mips.alphaCoverage = options.alpha_coverage;
+
+    PAA paa;
+    paa.setEncoderTier(qualityOption(options.quality));
+    paa.setMipSettings(mips);
+
+    // The mip chain owns and filters its own copy of the top level
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.data.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    paa.loadImage(std::move(image));
+
+    return paa.encodePAA(out, capacity, format);
+}
+
+PAAHeaderView parse(const uint8_t* paa, size_t size) {
+    if (!paa) {
+        throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "PAA buffer is NULL"};
+    }
+    try {
+        return parsePAAHeaders(paa, size);
+    } catch (const std::runtime_error& e) {
+        throw ApiError{ARMA3PAA_ERROR_CORRUPT, e.what()};
+    }
+}
+
+void decode(const uint8_t* paa, size_t size, uint32_t level, uint8_t* rgba, size_t capacity,
+            uint32_t& width, uint32_t& height) {
+    PAAHeaderView view = parse(paa, size);
+    if (level >= view.mips.size()) {
+        throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Mipmap level out of range"};
+    }
+
+    const PAAHeaderView::Level& mip = view.mips[level];
+    width = mip.width;
+    height = mip.height;
+
+    if (mip.lzoCompressed) {
+        throw ApiError{ARMA3PAA_ERROR_UNSUPPORTED, "LZO decompression not available in this build"};
+    }
+    if (dxtBlockBytes(view.format) == 0) {
+        throw ApiError{ARMA3PAA_ERROR_UNSUPPORTED,
+                       std::string("Unsupported PAA format for decoding: ") + formatName(view.format)};
+    }
+    if (!rgba || capacity < static_cast<size_t>(mip.width) * mip.height * 4) {
+        throw ApiError{ARMA3PAA_ERROR_BUFFER_TOO_SMALL, "RGBA buffer too small for mip level"};
+    }
+
+    try {
+        decodeDXTBlocks(view.format, mip.data, mip.dataLength, mip.width, mip.height, rgba);
+    } catch (const std::runtime_error& e) {
+        throw ApiError{ARMA3PAA_ERROR_CORRUPT, e.what()};
+    }
+}
+
+void runJob(arma3paa_job& job) {
+    std::string error;
+    job.output_size = 0;
+    job.status = guarded([&] {
+        if (job.kind == ARMA3PAA_JOB_ENCODE) {
+            if (job.input_size < static_cast<size_t>(job.width) * job.height * 4) {
+                throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Input smaller than width * height * 4"};
+            }
+            job.output_size = encode(job.input, job.width, job.height, job.options,
+                                     job.output, job.output_capacity);
+            if (job.output_size > job.output_capacity) {
+                throw ApiError{ARMA3PAA_ERROR_BUFFER_TOO_SMALL, "Output buffer too small"};
+            }
+        } else if (job.kind == ARMA3PAA_JOB_DECODE) {
+            decode(job.input, job.input_size, job.mip_level, job.output, job.output_capacity,
+                   job.width, job.height);
+            job.output_size = static_cast<size_t>(job.width) * job.height * 4;
+        } else {
+            throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "Unknown job kind"};
+        }
+    }, error);
+
+    size_t length = std::min(error.size(), sizeof(job.error) - 1);
+    std::memcpy(job.error, error.data(), length);
+    job.error[length] = '\0';
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t arma3paa_abi_version(void) {
+    return ARMA3PAA_ABI_VERSION;
+}
+
+const char* arma3paa_last_error(void) {
+    return lastError.c_str();
+}
+
+void arma3paa_encode_options_init(arma3paa_encode_options* options) {
+    if (!options) {
+        return;
+    }
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(*options);
+    options->format = ARMA3PAA_FORMAT_AUTO;
+    options->quality = ARMA3PAA_QUALITY_BALANCED;
+    options->mip_filter = ARMA3PAA_MIP_FILTER_BOX;
+}
+
+size_t arma3paa_encode_bound(uint32_t width, uint32_t height) {
+    return PAA::maxEncodedSize(width, height);
+}
+
+int arma3paa_encode(const uint8_t* rgba, uint32_t width, uint32_t height,
+                    const arma3paa_encode_options* options,
+                    uint8_t* out, size_t capacity, size_t* out_size) {
+    return guarded([&] {
+        size_t size = encode(rgba, width, height, options, out, capacity);
+        if (out_size) {
+            *out_size = size;
+        }
+        if (size > capacity) {
+            throw ApiError{ARMA3PAA_ERROR_BUFFER_TOO_SMALL, "Output buffer too small"};
+        }
+    });
+}
+
+int arma3paa_inspect(const uint8_t* paa, size_t size, arma3paa_info* info) {
+    return guarded([&] {
+        if (!info) {
+            throw ApiError{ARMA3PAA_ERROR_INVALID_ARGUMENT, "info is NULL"};
+        }
+        PAAHeaderView view = parse(paa, size);
+
+        std::memset(info, 0, sizeof(*info));
+        info->format = static_cast<uint32_t>(view.format);
+        info->mip_count = static_cast<uint32_t>(view.mips.size());
+        info->has_alpha = view.hasAlpha ? 1 : 0;
+        std::memcpy(info->average_color, view.averageColor, 4);
+        std::memcpy(info->max_color, view.maxColor, 4);
+        if (!view.mips.empty()) {
+            info->width = view.mips[0].width;
+            info->height = view.mips[0].height;
+        }
+
+        size_t described = std::min<size_t>(view.mips.size(), ARMA3PAA_MAX_MIPS);
+        for (size_t i = 0; i < described; i++) {
+            info->mips[i].width = view.mips[i].width;
+            info->mips[i].height = view.mips[i].height;
+            info->mips[i].data_size = view.mips[i].dataLength;
+            info->mips[i].lzo_compressed = view.mips[i].lzoCompressed ? 1 : 0;
+        }
+    });
+}
+
+int arma3paa_decode_mip(const uint8_t* paa, size_t size, uint32_t level,
+                        uint8_t* rgba, size_t capacity) {
+    return guarded([&] {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        decode(paa, size, level, rgba, capacity, width, height);
+    });
+}
+
+arma3paa_context* arma3paa_context_create(uint32_t threads) {
+    arma3paa_context* context = nullptr;
+    guarded([&] { context = new arma3paa_context(threads); });
+    return context;
+}
+
+void arma3paa_context_destroy(arma3paa_context* context) {
+    delete context;
+}
+
+int arma3paa_run_batch(arma3paa_context* context, arma3paa_job* jobs, size_t count) {
+    if (!context || (!jobs && count > 0)) {
+        lastError = "Invalid batch arguments";
+        return ARMA3PAA_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Wait only for this batch, so other threads can share the context
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = count;
+
+    for (size_t i = 0; i < count; i++) {
+        arma3paa_job* job = &jobs[i];
+        context->pool.submit([job, &mutex, &finished, &remaining] {
+            runJob(*job);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) {
+                finished.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return remaining == 0; });
+    lock.unlock();
+
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].status != ARMA3PAA_OK) {
+            lastError = jobs[i].error;
+            return jobs[i].status;
+        }
+    }
+    lastError.clear();
+    return ARMA3PAA_OK;
+}
+
+} // extern "C"
\ No newline at end of file
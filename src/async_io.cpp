@@ -0,0 +1,492 @@
+#include "async_io.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace arma3 {
+
+const char* ioBackendName(IOBackend backend) {
+    switch (backend) {
+        case IOBackend::Threads: return "threads";
+        case IOBackend::IoUring: return "io_uring";
+        case IOBackend::Auto: return "auto";
+        default: return "blocking";
+    }
+}
+
+IOBackend parseIOBackend(const std::string& name) {
+    if (name == "blocking") return IOBackend::Blocking;
+    if (name == "threads") return IOBackend::Threads;
+    if (name == "uring" || name == "io_uring") return IOBackend::IoUring;
+    if (name == "auto") return IOBackend::Auto;
+    throw std::runtime_error("Unknown I/O backend: " + name + " (blocking, threads, uring, auto)");
+}
+
+namespace {
+
+// Portable fallback: a small pool of threads doing ordinary blocking I/O.
+// Worker threads still never wait on the disk themselves.
+class ThreadedFileIO : public AsyncFileIO {
+public:
+    explicit ThreadedFileIO(size_t threads) : pool(threads) {}
+
+    void readFile(const std::string& path, ReadCallback onDone) override {
+        pool.submit([path, onDone = std::move(onDone)]() {
+            std::vector<uint8_t> data;
+            std::string error;
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) {
+                error = "Failed to open " + path;
+            } else {
+                data.resize(static_cast<size_t>(in.tellg()));
+                in.seekg(0);
+                if (!in.read(reinterpret_cast<char*>(data.data()), data.size())) {
+                    error = "Failed to read " + path;
+                    data.clear();
+                }
+            }
+            onDone(std::move(data), error);
+        });
+    }
+
+    void writeFile(const std::string& path, std::vector<uint8_t> data, WriteCallback onDone) override {
+        pool.submit([path, data = std::move(data), onDone = std::move(onDone)]() {
+            std::string error;
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out || !out.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+                error = "Failed to write " + path;
+            }
+            out.close();
+            onDone(error);
+        });
+    }
+
+    void drain() override { pool.wait(); }
+
+    IOBackend backend() const override { return IOBackend::Threads; }
+
+private:
+    ThreadPool pool;
+};
+
+#ifdef __linux__
+
+// io_uring through the raw syscalls, so there is no liburing dependency.
+// Submitters fill SQEs under a mutex; one completion thread reaps CQEs,
+// resubmits short transfers and runs the callbacks.
+class IoUringFileIO : public AsyncFileIO {
+public:
+    explicit IoUringFileIO(unsigned entries);
+    ~IoUringFileIO() override;
+
+    void readFile(const std::string& path, ReadCallback onDone) override;
+    void writeFile(const std::string& path, std::vector<uint8_t> data, WriteCallback onDone) override;
+    void drain() override;
+
+    IOBackend backend() const override { return IOBackend::IoUring; }
+
+private:
+    struct Request {
+        bool write = false;
+        int fd = -1;
+        std::string path;
+        std::vector<uint8_t> buffer;
+        uint64_t done = 0;
+        ReadCallback onRead;
+        WriteCallback onWrite;
+    };
+
+    void submit(Request* request, bool holdsSlot);
+    void finish(Request* request, std::string error);
+    void completionLoop();
+    void release();
+
+    int ringFd = -1;
+    unsigned sqEntries = 0;
+
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    std::mutex submitMutex;
+    std::condition_variable slotFree;
+    unsigned inFlight = 0;  // SQEs submitted and not yet reaped
+
+    std::mutex pendingMutex;
+    std::condition_variable allDone;
+    size_t pending = 0;  // requests whose callback has not returned yet
+
+    std::thread completionThread;
+};
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// Whole-file transfers are split so a single SQE never exceeds this
+const uint64_t MaxTransfer = 1u << 30;
+
+IoUringFileIO::IoUringFileIO(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ringFd = ioUringSetup(entries, &params);
+    if (ringFd < 0) {
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+    }
+    sqEntries = params.sq_entries;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+    } else if (singleMap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd, IORING_OFF_SQES);
+    sqes = sqeMap == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqeMap);
+
+    if (!sqRing || !cqRing || !sqes) {
+        release();
+        throw std::runtime_error("io_uring: failed to map the rings");
+    }
+
+    // IORING_OP_READ/WRITE need 5.6+; an older kernel still accepts the ring
+    std::vector<uint8_t> probeStorage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(probeStorage.data());
+    bool supported = ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                     probe->last_op >= IORING_OP_WRITE &&
+                     (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                     (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    if (!supported) {
+        release();
+        throw std::runtime_error("io_uring: kernel lacks IORING_OP_READ/WRITE");
+    }
+
+    auto* sq = static_cast<uint8_t*>(sqRing);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto* cq = static_cast<uint8_t*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    completionThread = std::thread([this]() { completionLoop(); });
+}
+
+IoUringFileIO::~IoUringFileIO() {
+    if (completionThread.joinable()) {
+        drain();
+
+        // A NOP with user_data 0 tells the completion thread to exit
+        {
+            std::lock_guard<std::mutex> lock(submitMutex);
+            unsigned tail = *sqTail;
+            unsigned index = tail & *sqMask;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = 0;
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            while (ioUringEnter(ringFd, 1, 0, 0) < 0 && errno == EINTR) {
+            }
+        }
+        completionThread.join();
+    }
+    release();
+}
+
+void IoUringFileIO::release() {
+    if (sqes) munmap(sqes, sqesSize);
+    if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing) munmap(sqRing, sqRingSize);
+    if (ringFd >= 0) close(ringFd);
+    sqes = nullptr;
+    sqRing = cqRing = nullptr;
+    ringFd = -1;
+}
+
+void IoUringFileIO::readFile(const std::string& path, ReadCallback onDone) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::string error = "Failed to open " + path + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        onDone({}, error);
+        return;
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        onDone({}, "");
+        return;
+    }
+
+    auto* request = new Request;
+    request->fd = fd;
+    request->path = path;
+    request->buffer.resize(static_cast<size_t>(info.st_size));
+    request->onRead = std::move(onDone);
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending++;
+    }
+    submit(request, false);
+}
+
+void IoUringFileIO::writeFile(const std::string& path, std::vector<uint8_t> data, WriteCallback onDone) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        onDone("Failed to open " + path + " for writing: " + std::strerror(errno));
+        return;
+    }
+    if (data.empty()) {
+        close(fd);
+        onDone("");
+        return;
+    }
+
+    auto* request = new Request;
+    request->write = true;
+    request->fd = fd;
+    request->path = path;
+    request->buffer = std::move(data);
+    request->onWrite = std::move(onDone);
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending++;
+    }
+    submit(request, false);
+}
+
+void IoUringFileIO::submit(Request* request, bool holdsSlot) {
+    std::unique_lock<std::mutex> lock(submitMutex);
+    if (!holdsSlot) {
+        // Keep one entry spare for the shutdown NOP
+        slotFree.wait(lock, [this]() { return inFlight + 1 < sqEntries; });
+        inFlight++;
+    }
+
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    uint64_t remaining = request->buffer.size() - request->done;
+    sqe->opcode = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = request->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(request->buffer.data() + request->done);
+    sqe->len = static_cast<uint32_t>(std::min(remaining, MaxTransfer));
+    sqe->off = request->done;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    while ((submitted = ioUringEnter(ringFd, 1, 0, 0)) < 0 && (errno == EINTR || errno == EAGAIN)) {
+    }
+    if (submitted < 0) {
+        // Without SQPOLL the kernel only consumes SQEs inside enter, so the
+        // entry can be taken back and the request failed
+        std::string error = std::string("io_uring_enter failed: ") + std::strerror(errno);
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        lock.unlock();
+        finish(request, error);
+    }
+}
+
+void IoUringFileIO::completionLoop() {
+    for (;;) {
+        if (ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            return;
+        }
+
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        bool stop = false;
+
+        // Requests are handed over through the kernel, which the memory model
+        // (and ThreadSanitizer) can't see; taking the submit mutex orders our
+        // reads after the submitter finished writing them
+        { std::lock_guard<std::mutex> lock(submitMutex); }
+
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & *cqMask];
+            head++;
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+            auto* request = reinterpret_cast<Request*>(cqe.user_data);
+            if (!request) {
+                stop = true;
+                continue;
+            }
+
+            if (cqe.res < 0) {
+                finish(request, (request->write ? "Failed to write " : "Failed to read ") +
+                                request->path + ": " + std::strerror(-cqe.res));
+                continue;
+            }
+
+            if (cqe.res == 0 && !request->write) {
+                // File shrank after fstat; keep what was read
+                request->buffer.resize(request->done);
+            }
+            request->done += static_cast<uint64_t>(cqe.res);
+
+            if (request->done < request->buffer.size() && cqe.res > 0) {
+                // Short transfer: reuse this request's slot for the rest
+                submit(request, true);
+            } else if (request->done < request->buffer.size()) {
+                finish(request, "Failed to write " + request->path + ": no progress");
+            } else {
+                finish(request, "");
+            }
+        }
+
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void IoUringFileIO::finish(Request* request, std::string error) {
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        inFlight--;
+    }
+    slotFree.notify_one();
+
+    if (close(request->fd) != 0 && request->write && error.empty()) {
+        // Delayed write errors (e.g. NFS) only show up on close
+        error = "Failed to write " + request->path + ": " + std::strerror(errno);
+    }
+
+    // A throwing callback must not kill the completion thread
+    try {
+        if (request->write) {
+            request->onWrite(error);
+        } else {
+            request->onRead(error.empty() ? std::move(request->buffer) : std::vector<uint8_t>(), error);
+        }
+    }
+    catch (...) {
+    }
+    delete request;
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (--pending == 0) {
+        allDone.notify_all();
+    }
+}
+
+void IoUringFileIO::drain() {
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+#endif // __linux__
+
+} // namespace
+
+bool ioUringAvailable() {
+#ifdef __linux__
+    try {
+        IoUringFileIO probe(4);
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<AsyncFileIO> AsyncFileIO::create(IOBackend backend, size_t queueDepth) {
+    queueDepth = std::max<size_t>(queueDepth, 4);
+
+    switch (backend) {
+        case IOBackend::Blocking:
+            return nullptr;
+        case IOBackend::Threads:
+            break;
+        case IOBackend::IoUring:
+#ifdef __linux__
+            return std::make_unique<IoUringFileIO>(static_cast<unsigned>(queueDepth));
+#else
+            throw std::runtime_error("io_uring is only available on Linux");
+#endif
+        case IOBackend::Auto:
+#ifdef __linux__
+            try {
+                return std::make_unique<IoUringFileIO>(static_cast<unsigned>(queueDepth));
+            }
+            catch (const std::exception&) {
+                // Old kernel, or io_uring blocked by seccomp/container policy
+            }
+#endif
+            break;
+    }
+
+    // Enough threads to keep several requests in flight on fast storage
+    size_t threads = std::min<size_t>(queueDepth, std::max(4u, std::thread::hardware_concurrency()));
+    return std::make_unique<ThreadedFileIO>(threads);
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,721 @@
+#include "batch_converter.h"
+#include "buffer_pool.h"
+#include "cpu_topology.h"
+#include "image_loader.h"
+#include "sharding.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace arma3 {
+
+const char* tierName(EncoderTier tier) {
+    switch (tier) {
+        case EncoderTier::Fast: return "fast";
+        case EncoderTier::Best: return "best";
+        default: return "balanced";
+    }
+}
+
+const char* alphaName(AlphaKind alpha) {
+    switch (alpha) {
+        case AlphaKind::Opaque: return "opaque";
+        case AlphaKind::Binary: return "1-bit alpha";
+        default: return "alpha";
+    }
+}
+
+uint64_t settingsHash(const ConvertOptions& options) {
+    std::string key = "v1";
+    key += "|format=" + std::to_string(static_cast<int>(options.format));
+    key += "|tier=" + std::to_string(static_cast<int>(options.tier));
+    key += "|auto=" + std::to_string(options.autoMode);
+    if (options.mips.maxSize != 0 || options.mips.dropMips != 0) {
+        key += "|max=" + std::to_string(options.mips.maxSize);
+        key += "|drop=" + std::to_string(options.mips.dropMips);
+    }
+    if (options.mips.filter != MipFilter::Box) {
+        key += "|filter=" + std::string(mipFilterName(options.mips.filter));
+        key += "|linear=" + std::to_string(options.mips.linearLight);
+    }
+    if (options.mips.alphaCoverage > 0.0f) {
+        key += "|coverage=" + std::to_string(options.mips.alphaCoverage);
+    }
+    if (options.autoMode) {
+        key += "|psnr=" + std::to_string(options.autoSettings.minPSNR);
+        key += "|ssim=" + std::to_string(options.autoSettings.minSSIM);
+    }
+    return utils::hashString(key);
+}
+
+namespace {
+
+// Shared by the file and in-memory paths: applies the tier, runs --auto and
+// returns the format to encode with
+PAAFormat chooseFormat(PAA& paa, const ConvertOptions& options, ConvertResult& result) {
+    result.width = paa.getMipMaps()[0].width;
+    result.height = paa.getMipMaps()[0].height;
+
+    if (!options.autoMode) {
+        return options.format;
+    }
+
+    AutoEncodeDecision decision = paa.chooseEncoding(options.autoSettings);
+    std::string& note = result.note;
+
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "auto: %s/%s, %s, PSNR %.1f dB%s",
+        formatName(decision.format), tierName(decision.tier), alphaName(decision.alpha),
+        decision.quality.psnr, decision.metTarget ? "" : " (below target)");
+    note = buffer;
+    if (decision.quality.ssim >= 0.0) {
+        std::snprintf(buffer, sizeof(buffer), ", SSIM %.3f", decision.quality.ssim);
+        note += buffer;
+    }
+    return decision.format;
+}
+
+bool isSourceImage(const std::string& path) {
+    std::string ext = fs::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".png" || ext == ".tga";
+}
+
+// The watcher SIGINT/SIGTERM stop; interrupt() only writes to a pipe
+std::atomic<FileWatcher*> activeWatcher{nullptr};
+
+extern "C" void stopWatching(int) {
+    if (FileWatcher* watcher = activeWatcher.load()) {
+        watcher->interrupt();
+    }
+}
+
+void printBufferPool() {
+    BufferPoolStats stats = bufferPoolStats();
+    uint64_t acquires = stats.hits + stats.misses;
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "Buffer pool: %llu hits, %llu misses (%.1f%% reused), %.1f MiB held\n",
+                  static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                  acquires ? 100.0 * stats.hits / acquires : 0.0, stats.pooledBytes / (1024.0 * 1024.0));
+    std::cout << buffer;
+}
+
+} // namespace
+
+ConvertResult convertFile(const std::string& input, const std::string& output, const ConvertOptions& options) {
+    ConvertResult result;
+    PAA paa;
+    paa.setEncoderTier(options.tier);
+    paa.setMipSettings(options.mips);
+
+    ImageData image;
+    {
+        StageScope stageScope(Stage::Decode);
+        MemoryStageScope memoryScope(MemoryStage::Decode);
+        image = ImageLoader::load(input);
+    }
+    paa.loadImage(std::move(image));
+
+    PAAFormat format = chooseFormat(paa, options, result);
+    paa.writePAA(output, format, options.atomicWrite);
+    return result;
+}
+
+ConvertResult convertBuffer(const std::vector<uint8_t>& source, const std::string& name,
+                            const ConvertOptions& options, std::vector<uint8_t>& encoded) {
+    ConvertResult result;
+    PAA paa;
+    paa.setEncoderTier(options.tier);
+    paa.setMipSettings(options.mips);
+
+    ImageData image;
+    {
+        StageScope stageScope(Stage::Decode);
+        MemoryStageScope memoryScope(MemoryStage::Decode);
+        image = ImageLoader::loadFromMemory(source.data(), source.size(), name);
+    }
+    paa.loadImage(std::move(image));
+
+    PAAFormat format = chooseFormat(paa, options, result);
+    encoded = paa.encodePAA(format);
+    return result;
+}
+
+BatchConverter::BatchConverter(const BatchOptions& batchOptions, const ConvertOptions& convertOptions)
+    : batch(batchOptions),
+      convert(convertOptions),
+      currentSettings(settingsHash(convertOptions)),
+      manifestPath(BuildManifest::defaultPath(batchOptions.outputDir)),
+      pool(batchOptions.threads, batchOptions.pinWorkers),
+      io(AsyncFileIO::create(batchOptions.io, batchOptions.ioQueueDepth)) {
+    report.shardIndex = batch.shardIndex;
+    report.shardCount = batch.shardCount;
+    // Enough decoded-ahead sources to keep every worker busy, but no more
+    readAheadLimit = std::max<size_t>(2 * pool.size(), batch.ioQueueDepth);
+}
+
+std::string BatchConverter::outputPathFor(const DiscoveredFile& file) const {
+    // Keep the source tree layout below the output directory, so equal file
+    // names in different directories don't collide. Anything that still
+    // maps two sources to one output is rejected in submit()
+    fs::path relative = fs::path(batch.outputDir.empty() ? file.path : file.relativePath);
+    relative.replace_extension(".paa");
+
+    if (!batch.outputDir.empty()) {
+        return (fs::path(batch.outputDir) / relative).string();
+    }
+    return relative.string();
+}
+
+void BatchConverter::discover(const std::function<void(const DiscoveredFile&)>& onFile) {
+    if (batch.filesFrom == "-") {
+        readNulSeparatedList(std::cin, onFile);
+    } else if (!batch.filesFrom.empty()) {
+        std::ifstream list(batch.filesFrom, std::ios::binary);
+        if (!list) {
+            throw std::runtime_error("Failed to open file list: " + batch.filesFrom);
+        }
+        readNulSeparatedList(list, onFile);
+    } else {
+        discoverFiles(batch.pattern, onFile);
+    }
+}
+
+void BatchConverter::submit(const DiscoveredFile& file) {
+    discoveredCount++;
+    auto job = std::make_shared<Job>();
+    job->file = file;
+
+    // A second source for the same output would silently overwrite the
+    // first. Watch mode resubmits the same source, which is fine
+    std::string output = fs::path(outputPathFor(file)).lexically_normal().generic_string();
+    std::string claimedBy;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto claim = outputSources.emplace(output, file.path);
+        if (!claim.second && claim.first->second != file.path) {
+            claimedBy = claim.first->second;
+        }
+    }
+    if (!claimedBy.empty()) {
+        job->outFile = outputPathFor(file);
+        job->result.output = job->outFile;
+        job->start = std::chrono::high_resolution_clock::now();
+        complete(*job, ConvertResult(), "Output " + job->outFile + " is already written from " + claimedBy);
+        return;
+    }
+
+    if (io) {
+        // Issue the read now so it overlaps with encoding of earlier files;
+        // skipped files are never read
+        try {
+            if (prepare(*job)) {
+                return;
+            }
+        }
+        catch (const std::exception& e) {
+            job->start = std::chrono::high_resolution_clock::now();
+            complete(*job, ConvertResult(), e.what());
+            return;
+        }
+        readAhead(job);
+    }
+
+    pool.submit([this, job]() { convertOne(job); });
+}
+
+void BatchConverter::submitSharded() {
+    // Sharding needs the complete file set so every node computes the same split
+    std::mutex listMutex;
+    std::vector<DiscoveredFile> files;
+    discover([&](const DiscoveredFile& file) {
+        std::lock_guard<std::mutex> lock(listMutex);
+        files.push_back(file);
+    });
+
+    std::vector<ShardItem> items;
+    std::unordered_map<std::string, DiscoveredFile> byPath;
+    for (const auto& file : files) {
+        ShardItem item;
+        item.path = fs::path(file.path).lexically_normal().generic_string();
+        uint32_t width = 0, height = 0;
+        if (ImageLoader::readDimensions(file.path, width, height)) {
+            item.weight = static_cast<uint64_t>(width) * height;
+        }
+        byPath[item.path] = file;
+        items.push_back(std::move(item));
+    }
+
+    std::cout << "Found " << files.size() << " files\n";
+
+    std::vector<ShardItem> selected = selectShard(std::move(items), batch.shardIndex, batch.shardCount);
+    std::cout << "Shard " << batch.shardIndex << "/" << batch.shardCount << ": "
+              << selected.size() << " files\n";
+
+    for (const auto& item : selected) {
+        submit(byPath[item.path]);
+    }
+}
+
+bool BatchConverter::prepare(Job& job) {
+    job.prepared = true;
+    job.outFile = outputPathFor(job.file);
+    job.result.input = job.file.path;
+    job.result.output = job.outFile;
+
+    if (!batch.incremental) {
+        return false;
+    }
+
+    // Decide from metadata alone; the source is not opened
+    ManifestEntry& entry = job.entry;
+    fs::path sourcePath(job.file.path);
+    entry.sourcePath = sourcePath.lexically_normal().string();
+    entry.outputPath = job.outFile;
+    entry.sourceSize = fs::file_size(sourcePath);
+    entry.sourceMtime = fs::last_write_time(sourcePath).time_since_epoch().count();
+    entry.settingsHash = currentSettings;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        seenSources.insert(entry.sourcePath);
+    }
+
+    if (!manifest.isUpToDate(entry.sourcePath, entry.sourceSize, entry.sourceMtime,
+                             currentSettings, job.outFile)) {
+        return false;
+    }
+
+    upToDateCount++;
+    recordUpToDate();
+    job.result.skipped = true;
+    std::lock_guard<std::mutex> lock(mutex);
+    report.files.push_back(std::move(job.result));
+    return true;
+}
+
+void BatchConverter::readAhead(const std::shared_ptr<Job>& job) {
+    {
+        // Blocks discovery, not workers, when encoding falls behind
+        std::unique_lock<std::mutex> lock(readAheadMutex);
+        readAheadSlot.wait(lock, [this]() { return readAheadCount < readAheadLimit; });
+        readAheadCount++;
+    }
+
+    auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    job->source = promise->get_future();
+    io->readFile(job->file.path, [promise](std::vector<uint8_t> data, const std::string& error) {
+        if (error.empty()) {
+            promise->set_value(std::move(data));
+        } else {
+            promise->set_exception(std::make_exception_ptr(std::runtime_error(error)));
+        }
+    });
+}
+
+void BatchConverter::releaseReadAhead() {
+    {
+        std::lock_guard<std::mutex> lock(readAheadMutex);
+        readAheadCount--;
+    }
+    readAheadSlot.notify_one();
+}
+
+void BatchConverter::convertOne(const std::shared_ptr<Job>& job) {
+    job->start = std::chrono::high_resolution_clock::now();
+    // Pinned workers never migrate, so this is the node for the whole job
+    job->result.node = currentNode();
+    if (batch.bufferPool) {
+        enableThreadBufferPool();
+    }
+    StageRecorder recorder(job->result.stages);
+    WorkerBusyScope busy;
+    // Copied into the result before the job can complete on another thread
+    FileMemory memory;
+    FileMemoryRecorder memoryRecorder(memory);
+
+    try {
+        std::vector<uint8_t> source;
+        if (io) {
+            try {
+                StageScope stageScope(Stage::Read);
+                source = job->source.get();
+            }
+            catch (...) {
+                releaseReadAhead();
+                throw;
+            }
+            releaseReadAhead();
+        } else if (prepare(*job)) {
+            return;
+        }
+
+        fs::path parent = fs::path(job->outFile).parent_path();
+        if (!parent.empty()) {
+            std::error_code ec;
+            fs::create_directories(parent, ec);
+        }
+
+        FileResult& fileResult = job->result;
+        if (!io) {
+            ConvertResult result = convertFile(job->file.path, job->outFile, convert);
+            fileResult.bytesIn = fs::file_size(job->file.path);
+            fileResult.bytesOut = fs::file_size(job->outFile);
+            fileResult.memory = memory;
+            complete(*job, result, "");
+            return;
+        }
+
+        std::vector<uint8_t> encoded;
+        ConvertResult result = convertBuffer(source, job->file.path, convert, encoded);
+        fileResult.bytesIn = source.size();
+        fileResult.bytesOut = encoded.size();
+        source = std::vector<uint8_t>();
+
+        // The worker moves straight on to the next file; the log line and
+        // manifest entry follow once the write has landed
+        std::string target = convert.atomicWrite ? utils::temporaryPathFor(job->outFile) : job->outFile;
+        fileResult.memory = memory;
+        auto writeStart = std::chrono::steady_clock::now();
+        io->writeFile(target, std::move(encoded), [this, job, result, target, writeStart](const std::string& error) {
+            job->result.stages[Stage::Write] +=
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count();
+            std::string finalError = error;
+            job->cause = FailureCause::Write;
+            if (target != job->outFile) {
+                try {
+                    if (error.empty()) {
+                        utils::replaceFile(target, job->outFile);
+                    } else {
+                        std::remove(target.c_str());
+                    }
+                }
+                catch (const std::exception& e) {
+                    finalError = e.what();
+                }
+            }
+            complete(*job, result, finalError);
+        });
+    }
+    catch (const std::exception& e) {
+        job->cause = failureCauseFor(recorder.lastStage());
+        complete(*job, ConvertResult(), e.what());
+    }
+}
+
+void BatchConverter::complete(Job& job, const ConvertResult& converted, const std::string& error) {
+    FileResult& fileResult = job.result;
+    fileResult.input = job.file.path;
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (error.empty()) {
+        fileResult.pixels = static_cast<uint64_t>(converted.width) * converted.height;
+        if (batch.incremental) {
+            job.entry.outputSize = fileResult.bytesOut;
+            manifest.record(job.entry);
+        }
+
+        ConversionSample sample;
+        sample.pixels = fileResult.pixels;
+        sample.bytesWritten = fileResult.bytesOut;
+        sample.seconds = std::chrono::duration<double>(end - job.start).count();
+        sample.stages = fileResult.stages;
+        recordConversion(sample);
+    } else {
+        recordFailure(job.cause);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error.empty()) {
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - job.start);
+        std::cout << "✓ " << job.file.path << " → " << job.outFile
+                  << " (" << duration.count() << "ms"
+                  << (converted.note.empty() ? "" : ", " + converted.note) << ")\n";
+        successCount++;
+    } else {
+        std::cerr << "✗ " << job.file.path << " - Error: " << error << "\n";
+        fileResult.ok = false;
+        fileResult.error = error;
+        failCount++;
+    }
+
+    fileResult.milliseconds = std::chrono::duration<double, std::milli>(end - job.start).count();
+    report.files.push_back(std::move(fileResult));
+
+    if (watcher) {
+        inFlight.erase(job.file.path);
+        if (dirty.erase(job.file.path)) {
+            // Saved again mid-conversion. Handed back to the watch loop:
+            // submitting from here could block a worker on read-ahead
+            reruns.push_back(job.file.path);
+            watcher->wake();
+        }
+    }
+}
+
+std::unique_ptr<MetricsExporter> BatchConverter::startMetrics() {
+    if (batch.metricsPath.empty()) {
+        return nullptr;
+    }
+    // Gauges are read on the exporter's thread; pendingTasks() takes the
+    // pool's queue lock once per export, never per block
+    return std::make_unique<MetricsExporter>(
+        batch.metricsPath, std::chrono::milliseconds(batch.metricsIntervalMs), [this]() {
+            MetricsGauges gauges;
+            gauges.queueDepth = pool.pendingTasks();
+            gauges.workers = pool.size();
+            return gauges;
+        });
+}
+
+void BatchConverter::reportMemory() {
+    std::vector<NamedFileMemory> files;
+    for (const auto& file : report.files) {
+        if (file.ok && !file.skipped) {
+            files.push_back({file.input, file.pixels, file.memory});
+        }
+    }
+
+    // Heaviest first: these are the textures that set the peak RSS
+    std::sort(files.begin(), files.end(), [](const NamedFileMemory& a, const NamedFileMemory& b) {
+        return a.memory.peakBytes > b.memory.peakBytes;
+    });
+
+    AllocationSnapshot snapshot = snapshotAllocations();
+    if (!batch.statsPath.empty()) {
+        std::ofstream out(batch.statsPath);
+        out << allocationStatsToJSON(snapshot, files) << "\n";
+        if (!out) {
+            std::cerr << "Warning: failed to write " << batch.statsPath << "\n";
+        }
+    }
+
+    const size_t shown = 10;
+    if (files.size() > shown) {
+        files.resize(shown);
+    }
+    printAllocationStats(std::cout, snapshot, files);
+}
+
+int BatchConverter::run() {
+    std::cout << "Batch mode: " << (batch.filesFrom.empty() ? batch.pattern : "file list " + batch.filesFrom)
+              << " (" << pool.size() << " workers"
+              << (pool.pinned() ? " pinned over " + std::to_string(CpuTopology::get().nodeCount) + " NUMA nodes" : "")
+              << (io ? std::string(", ") + ioBackendName(io->backend()) + " I/O" : "") << ")\n";
+
+    if (!batch.outputDir.empty() && !fs::exists(batch.outputDir)) {
+        fs::create_directories(batch.outputDir);
+    }
+
+    if (batch.incremental) {
+        manifest.load(manifestPath);
+    }
+
+    if (batch.stats) {
+        if (!allocationHooksInstalled()) {
+            std::cerr << "Warning: allocation statistics are not available in this build\n";
+        }
+        resetPeakResidentSize();
+        enableAllocationTracking();
+    }
+
+    auto batchStart = std::chrono::steady_clock::now();
+    // Writes a final snapshot when run() returns
+    std::unique_ptr<MetricsExporter> metrics = startMetrics();
+
+    if (batch.shardCount > 1) {
+        submitSharded();
+    } else {
+        // Stream: workers start encoding while the tree is still being walked
+        discover([this](const DiscoveredFile& file) { submit(file); });
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cout << "Found " << discoveredCount << " files\n";
+    }
+
+    pool.wait();
+    if (io) {
+        io->drain();
+    }
+
+    if (batch.incremental) {
+        // Outputs whose source was deleted since the last run
+        for (const auto& stale : manifest.pruneMissing(seenSources)) {
+            std::error_code ec;
+            if (fs::remove(stale.outputPath, ec)) {
+                std::cout << "- " << stale.outputPath << " (source removed)\n";
+            }
+        }
+        manifest.save(manifestPath);
+    }
+
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+    BufferPoolStats poolStats = bufferPoolStats();
+    report.bufferPoolHits = poolStats.hits;
+    report.bufferPoolMisses = poolStats.misses;
+    if (!batch.reportPath.empty()) {
+        report.write(batch.reportPath);
+    }
+
+    if (batch.stats) {
+        disableAllocationTracking();
+        reportMemory();
+    }
+
+    std::cout << "\nBatch complete: " << successCount << " successful, "
+              << failCount << " failed";
+    if (batch.incremental) {
+        std::cout << ", " << upToDateCount << " up to date";
+    }
+    std::cout << "\n";
+    if (batch.bufferPool) {
+        printBufferPool();
+    }
+
+    if (pool.pinned()) {
+        std::map<int, size_t> perNode;
+        for (const auto& file : report.files) {
+            if (file.ok && !file.skipped) {
+                perNode[file.node]++;
+            }
+        }
+        std::cout << "Files per NUMA node:";
+        for (const auto& [node, files] : perNode) {
+            std::cout << " " << (node < 0 ? std::string("?") : std::to_string(node)) << ": " << files;
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+void BatchConverter::schedule(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!inFlight.insert(path).second) {
+            dirty.insert(path);
+            return;
+        }
+    }
+
+    DiscoveredFile file;
+    file.path = path;
+    file.relativePath = fs::path(path).lexically_relative(batch.watchDir).generic_string();
+    submit(file);
+}
+
+int BatchConverter::watch() {
+    // Readers of the outputs (the game, Addon Builder) may open them at any time
+    convert.atomicWrite = true;
+    batch.incremental = false;
+    batch.watchDir = fs::path(batch.watchDir).lexically_normal().generic_string();
+    if (batch.watchDir.size() > 1 && batch.watchDir.back() == '/') {
+        batch.watchDir.pop_back();
+    }
+
+    FileWatcher fileWatcher(batch.watchDir, std::chrono::milliseconds(batch.debounceMs));
+
+    if (!batch.outputDir.empty() && !fs::exists(batch.outputDir)) {
+        fs::create_directories(batch.outputDir);
+    }
+
+    if (batch.stats) {
+        if (!allocationHooksInstalled()) {
+            std::cerr << "Warning: allocation statistics are not available in this build\n";
+        }
+        enableAllocationTracking();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        watcher = &fileWatcher;
+        std::cout << "Watching " << batch.watchDir << " (" << fileWatcher.watchedDirectories() << " directories, "
+                  << pool.size() << " workers, " << batch.debounceMs << "ms debounce); Ctrl+C to stop\n";
+    }
+
+    std::unique_ptr<MetricsExporter> metrics = startMetrics();
+
+    activeWatcher.store(&fileWatcher);
+    auto previousInt = std::signal(SIGINT, stopWatching);
+    auto previousTerm = std::signal(SIGTERM, stopWatching);
+
+    int startSuccess = successCount;
+    int startFail = failCount;
+    std::vector<WatchEvent> events;
+
+    while (fileWatcher.wait(events)) {
+        for (const auto& event : events) {
+            if (event.kind == WatchEvent::Kind::Rescan) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::cout << "Event queue overflowed; rescanning " << event.path << "\n";
+                }
+                fileWatcher.rescan();
+                discoverFiles(event.path + "/**/*", [this](const DiscoveredFile& file) {
+                    if (isSourceImage(file.path)) {
+                        schedule(file.path);
+                    }
+                });
+            } else if (!isSourceImage(event.path)) {
+                continue;
+            } else if (event.kind == WatchEvent::Kind::Changed) {
+                schedule(event.path);
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::cout << "- " << event.path << " (source removed; output kept)\n";
+            }
+        }
+        events.clear();
+
+        std::vector<std::string> again;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            again.swap(reruns);
+            // A long-running watch must not accumulate results; --stats keeps
+            // them for the per-file table
+            if (!batch.stats) {
+                report.files.clear();
+            }
+        }
+        for (const auto& path : again) {
+            schedule(path);
+        }
+    }
+
+    std::signal(SIGINT, previousInt);
+    std::signal(SIGTERM, previousTerm);
+    activeWatcher.store(nullptr);
+
+    pool.wait();
+    if (io) {
+        io->drain();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        watcher = nullptr;
+    }
+
+    if (batch.stats) {
+        disableAllocationTracking();
+        reportMemory();
+    }
+
+    std::cout << "\nWatch stopped: " << successCount - startSuccess << " converted, "
+              << failCount - startFail << " failed\n";
+    if (batch.bufferPool) {
+        printBufferPool();
+    }
+    return 0;
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "batch_report.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace arma3 {
+
+using utils::jsonEscape;
+
+namespace {
+
+// Just enough JSON to read back what BatchReport::write produces
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    const JsonValue& operator[](const std::string& key) const {
+        static const JsonValue null;
+        auto it = object.find(key);
+        return it == object.end() ? null : it->second;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : s(text) {}
+
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipSpace();
+        if (pos != s.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const char* what) {
+        throw std::runtime_error(std::string("Invalid report JSON: ") + what + " at offset " + std::to_string(pos));
+    }
+
+    void skipSpace() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\n' || s[pos] == '\r' || s[pos] == '\t')) pos++;
+    }
+
+    bool consume(char ch) {
+        skipSpace();
+        if (pos < s.size() && s[pos] == ch) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char ch) {
+        if (!consume(ch)) fail("unexpected character");
+    }
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos >= s.size()) fail("unexpected end");
+
+        JsonValue value;
+        char ch = s[pos];
+        if (ch == '{') {
+            value.type = JsonValue::Type::Object;
+            pos++;
+            if (consume('}')) return value;
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.object[key] = parseValue();
+            } while (consume(','));
+            expect('}');
+        } else if (ch == '[') {
+            value.type = JsonValue::Type::Array;
+            pos++;
+            if (consume(']')) return value;
+            do {
+                value.array.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        } else if (ch == '"') {
+            value.type = JsonValue::Type::String;
+            value.string = parseString();
+        } else if (s.compare(pos, 4, "true") == 0) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            pos += 4;
+        } else if (s.compare(pos, 5, "false") == 0) {
+            value.type = JsonValue::Type::Bool;
+            pos += 5;
+        } else if (s.compare(pos, 4, "null") == 0) {
+            pos += 4;
+        } else {
+            const char* begin = s.c_str() + pos;
+            char* end = nullptr;
+            value.type = JsonValue::Type::Number;
+            value.number = std::strtod(begin, &end);
+            if (end == begin) fail("bad number");
+            pos += end - begin;
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (pos >= s.size() || s[pos] != '"') fail("expected string");
+        pos++;
+
+        std::string out;
+        while (pos < s.size() && s[pos] != '"') {
+            char ch = s[pos++];
+            if (ch != '\\') {
+                out += ch;
+                continue;
+            }
+            if (pos >= s.size()) fail("bad escape");
+            char esc = s[pos++];
+            switch (esc) {
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                    // Only control characters are \u-escaped by jsonEscape
+                    if (pos + 4 > s.size()) fail("bad escape");
+                    out += static_cast<char>(std::strtol(s.substr(pos, 4).c_str(), nullptr, 16));
+                    pos += 4;
+                    break;
+                default: out += esc; break;
+            }
+        }
+        if (pos >= s.size()) fail("unterminated string");
+        pos++;
+        return out;
+    }
+
+    const std::string& s;
+    size_t pos = 0;
+};
+
+void addFile(ShardSummary& summary, const FileResult& file) {
+    summary.files++;
+    if (file.skipped) summary.skipped++;
+    else if (file.ok) summary.succeeded++;
+    else summary.failed++;
+    summary.encodeSeconds += file.milliseconds / 1000.0;
+    summary.pixels += file.pixels;
+    summary.bytesIn += file.bytesIn;
+    summary.bytesOut += file.bytesOut;
+}
+
+void writeSummary(std::ostream& os, const ShardSummary& summary) {
+    os << "{\"shard\":" << summary.shardIndex
+       << ",\"files\":" << summary.files
+       << ",\"succeeded\":" << summary.succeeded
+       << ",\"failed\":" << summary.failed
+       << ",\"skipped\":" << summary.skipped
+       << ",\"wall_seconds\":" << summary.wallSeconds
+       << ",\"encode_seconds\":" << summary.encodeSeconds
+       << ",\"pixels\":" << summary.pixels
+       << ",\"bytes_in\":" << summary.bytesIn
+       << ",\"bytes_out\":" << summary.bytesOut << "}";
+}
+
+} // namespace
+
+void BatchReport::write(const std::string& path) const {
+    std::ofstream ofs(path);
+    if (!ofs) {
+        throw std::runtime_error("Failed to write report: " + path);
+    }
+
+    ofs << "{\"shard\":" << shardIndex << ",\"shards\":" << shardCount
+        << ",\"wall_seconds\":" << wallSeconds
+        << ",\"buffer_pool\":{\"hits\":" << bufferPoolHits << ",\"misses\":" << bufferPoolMisses << "}"
+        << ",\"files\":[";
+    for (size_t i = 0; i < files.size(); i++) {
+        const FileResult& f = files[i];
+        ofs << (i ? ",\n" : "\n")
+            << "{\"input\":\"" << jsonEscape(f.input) << "\""
+            << ",\"output\":\"" << jsonEscape(f.output) << "\""
+            << ",\"ok\":" << (f.ok ? "true" : "false")
+            << ",\"skipped\":" << (f.skipped ? "true" : "false")
+            << ",\"ms\":" << f.milliseconds
+            << ",\"pixels\":" << f.pixels
+            << ",\"bytes_in\":" << f.bytesIn
+            << ",\"bytes_out\":" << f.bytesOut
+            << ",\"stages_ms\":{";
+        for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++) {
+            ofs << (s ? "," : "") << "\"" << stageName(static_cast<Stage>(s)) << "\":" << f.stages.ms[s];
+        }
+        ofs << "}";
+        if (f.memory.allocations > 0) {
+            ofs << ",\"memory\":{\"allocations\":" << f.memory.allocations
+                << ",\"bytes\":" << f.memory.bytes
+                << ",\"peak_bytes\":" << f.memory.peakBytes << "}";
+        }
+        if (f.node >= 0) {
+            ofs << ",\"node\":" << f.node;
+        }
+        if (!f.error.empty()) {
+            ofs << ",\"error\":\"" << jsonEscape(f.error) << "\"";
+        }
+        ofs << "}";
+    }
+    ofs << "\n]}\n";
+}
+
+BatchReport BatchReport::read(const std::string& path) {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        throw std::runtime_error("Failed to open report: " + path);
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    std::string text = buffer.str();
+
+    JsonValue root = JsonParser(text).parse();
+
+    BatchReport report;
+    report.shardIndex = static_cast<uint32_t>(root["shard"].number);
+    report.shardCount = static_cast<uint32_t>(std::max(1.0, root["shards"].number));
+    report.wallSeconds = root["wall_seconds"].number;
+    report.bufferPoolHits = static_cast<uint64_t>(root["buffer_pool"]["hits"].number);
+    report.bufferPoolMisses = static_cast<uint64_t>(root["buffer_pool"]["misses"].number);
+
+    for (const auto& item : root["files"].array) {
+        FileResult f;
+        f.input = item["input"].string;
+        f.output = item["output"].string;
+        f.ok = item["ok"].boolean;
+        f.skipped = item["skipped"].boolean;
+        f.error = item["error"].string;
+        f.milliseconds = item["ms"].number;
+        f.pixels = static_cast<uint64_t>(item["pixels"].number);
+        f.bytesIn = static_cast<uint64_t>(item["bytes_in"].number);
+        f.bytesOut = static_cast<uint64_t>(item["bytes_out"].number);
+        const JsonValue& stages = item["stages_ms"];
+        for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++) {
+            f.stages.ms[s] = stages[stageName(static_cast<Stage>(s))].number;
+        }
+        const JsonValue& memory = item["memory"];
+        f.memory.allocations = static_cast<uint64_t>(memory["allocations"].number);
+        f.memory.bytes = static_cast<uint64_t>(memory["bytes"].number);
+        f.memory.peakBytes = static_cast<int64_t>(memory["peak_bytes"].number);
+        const JsonValue& node = item["node"];
+        f.node = node.type == JsonValue::Type::Number ? static_cast<int>(node.number) : -1;
+        report.files.push_back(std::move(f));
+    }
+
+    return report;
+}
+
+MergedReport mergeReports(const std::vector<BatchReport>& reports) {
+    MergedReport merged;
+    uint32_t shardCount = 0;
+    std::vector<bool> present;
+
+    for (const auto& report : reports) {
+        ShardSummary summary;
+        summary.shardIndex = report.shardIndex;
+        summary.wallSeconds = report.wallSeconds;
+
+        for (const auto& file : report.files) {
+            addFile(summary, file);
+            addFile(merged.totals, file);
+            if (!file.ok) {
+                merged.failures.emplace_back(report.shardIndex, file);
+            }
+        }
+
+        merged.totals.wallSeconds = std::max(merged.totals.wallSeconds, report.wallSeconds);
+        merged.shards.push_back(summary);
+
+        shardCount = std::max(shardCount, report.shardCount);
+        if (present.size() < shardCount) present.resize(shardCount, false);
+        if (report.shardIndex < present.size()) present[report.shardIndex] = true;
+    }
+
+    for (uint32_t i = 0; i < present.size(); i++) {
+        if (!present[i]) merged.missingShards.push_back(i);
+    }
+
+    std::sort(merged.shards.begin(), merged.shards.end(),
+        [](const ShardSummary& a, const ShardSummary& b) { return a.shardIndex < b.shardIndex; });
+
+    if (!merged.shards.empty()) {
+        double sum = 0.0;
+        for (const auto& shard : merged.shards) sum += shard.wallSeconds;
+        double mean = sum / merged.shards.size();
+        merged.imbalance = mean > 0.0 ? merged.totals.wallSeconds / mean : 1.0;
+    }
+
+    return merged;
+}
+
+std::string MergedReport::toJSON() const {
+    std::ostringstream os;
+    os << "{\"totals\":";
+    writeSummary(os, totals);
+    os << ",\"imbalance\":" << imbalance << ",\"shards\":[";
+    for (size_t i = 0; i < shards.size(); i++) {
+        os << (i ? ",\n" : "\n");
+        writeSummary(os, shards[i]);
+    }
+    os << "\n],\"missing_shards\":[";
+    for (size_t i = 0; i < missingShards.size(); i++) {
+        os << (i ? "," : "") << missingShards[i];
+    }
+    os << "],\"failures\":[";
+    for (size_t i = 0; i < failures.size(); i++) {
+        os << (i ? ",\n" : "\n")
+           << "{\"shard\":" << failures[i].first
+           << ",\"input\":\"" << jsonEscape(failures[i].second.input) << "\""
+           << ",\"error\":\"" << jsonEscape(failures[i].second.error) << "\"}";
+    }
+    os << "\n]}\n";
+    return os.str();
+}
+
+} // namespace arma3
\ No newline at end of file
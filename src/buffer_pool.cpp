@@ -0,0 +1,134 @@
+#include "buffer_pool.h"
+
+#include <atomic>
+#include <memory>
+
+namespace arma3 {
+
+namespace {
+
+std::atomic<uint64_t> hitCount{0};
+std::atomic<uint64_t> missCount{0};
+std::atomic<uint64_t> recycleCount{0};
+std::atomic<uint64_t> dropCount{0};
+std::atomic<uint64_t> heldBytes{0};
+
+thread_local std::unique_ptr<BufferPool> threadPool;
+
+size_t sizeClass(size_t bytes) {
+    size_t index = 0;
+    while (bytes >>= 1) {
+        index++;
+    }
+    return index;
+}
+
+} // namespace
+
+BufferPool::~BufferPool() {
+    clear();
+}
+
+std::vector<uint8_t> BufferPool::acquire(size_t size) {
+    if (size >= MinBufferSize) {
+        // A buffer in class c holds [2^c, 2^(c+1)) bytes. The size's own
+        // class may hold one that is too small; the next one always fits
+        // and wastes less than 4x
+        size_t first = sizeClass(size);
+        for (size_t c = first; c < first + 2 && c < ClassCount; c++) {
+            auto& bin = classes[c];
+            for (size_t i = bin.size(); i-- > 0;) {
+                if (bin[i].capacity() < size) continue;
+
+                std::vector<uint8_t> buffer = std::move(bin[i]);
+                bin.erase(bin.begin() + i);
+                heldBytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+                hitCount.fetch_add(1, std::memory_order_relaxed);
+                // Shrinking is free; growing past the recycled size zero-fills
+                buffer.resize(size);
+                return buffer;
+            }
+        }
+        missCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return std::vector<uint8_t>(size);
+}
+
+void BufferPool::recycle(std::vector<uint8_t>&& buffer) {
+    size_t capacity = buffer.capacity();
+    if (capacity < MinBufferSize) {
+        return;
+    }
+
+    auto& bin = classes[sizeClass(capacity)];
+    if (bin.size() >= MaxPerClass) {
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        std::vector<uint8_t>().swap(buffer);
+        return;
+    }
+    // Contents stay: the next acquire of a size <= this one doesn't touch them
+    bin.push_back(std::move(buffer));
+    heldBytes.fetch_add(capacity, std::memory_order_relaxed);
+    recycleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferPool::clear() {
+    for (auto& bin : classes) {
+        for (const auto& buffer : bin) {
+            heldBytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+        }
+        bin.clear();
+        bin.shrink_to_fit();
+    }
+}
+
+void enableThreadBufferPool() {
+    if (!threadPool) {
+        threadPool = std::make_unique<BufferPool>();
+    }
+}
+
+bool threadBufferPoolEnabled() {
+    return threadPool != nullptr;
+}
+
+void disableThreadBufferPool() {
+    threadPool.reset();
+}
+
+std::vector<uint8_t> acquireBuffer(size_t size) {
+    if (threadPool) {
+        return threadPool->acquire(size);
+    }
+    return std::vector<uint8_t>(size);
+}
+
+void resizeBuffer(std::vector<uint8_t>& buffer, size_t size) {
+    if (buffer.capacity() >= size || !threadPool) {
+        buffer.resize(size);
+        return;
+    }
+    std::vector<uint8_t> replacement = threadPool->acquire(size);
+    threadPool->recycle(std::move(buffer));
+    buffer = std::move(replacement);
+}
+
+void recycleBuffer(std::vector<uint8_t>&& buffer) {
+    if (threadPool) {
+        threadPool->recycle(std::move(buffer));
+    }
+    // Without a pool the caller's moved-from vector frees it as usual
+    std::vector<uint8_t>().swap(buffer);
+}
+
+BufferPoolStats bufferPoolStats() {
+    BufferPoolStats stats;
+    stats.hits = hitCount.load(std::memory_order_relaxed);
+    stats.misses = missCount.load(std::memory_order_relaxed);
+    stats.recycled = recycleCount.load(std::memory_order_relaxed);
+    stats.dropped = dropCount.load(std::memory_order_relaxed);
+    stats.pooledBytes = heldBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace arma3
\ No newline at end of file
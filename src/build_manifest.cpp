@@ -0,0 +1,155 @@
+#include "build_manifest.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace arma3 {
+
+using namespace utils;
+
+static const char kManifestMagic[8] = {'P', 'A', 'A', 'M', 'A', 'N', 'I', 'F'};
+// 2: dropped the unused output content hash
+static const uint32_t kManifestVersion = 2;
+
+std::string BuildManifest::defaultPath(const std::string& outputDir) {
+    return (fs::path(outputDir.empty() ? "." : outputDir) / ".arma3paa-manifest").string();
+}
+
+static std::string readShortString(std::istream& stream) {
+    uint16_t length = readBytes<uint16_t>(stream);
+    return readString(stream, length);
+}
+
+static void writeShortString(std::ostream& stream, const std::string& str) {
+    if (str.size() > 0xFFFF) {
+        throw std::runtime_error("Path too long for manifest: " + str);
+    }
+    writeBytes(stream, static_cast<uint16_t>(str.size()));
+    writeString(stream, str);
+}
+
+bool BuildManifest::load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    char magic[8];
+    ifs.read(magic, sizeof(magic));
+    uint32_t version = readBytes<uint32_t>(ifs);
+    uint32_t count = readBytes<uint32_t>(ifs);
+    if (!ifs || std::string(magic, 8) != std::string(kManifestMagic, 8) || version != kManifestVersion) {
+        return false;
+    }
+
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        ManifestEntry entry;
+        entry.sourcePath = readShortString(ifs);
+        entry.outputPath = readShortString(ifs);
+        entry.sourceSize = readBytes<uint64_t>(ifs);
+        entry.sourceMtime = readBytes<int64_t>(ifs);
+        entry.settingsHash = readBytes<uint64_t>(ifs);
+        entry.outputSize = readBytes<uint64_t>(ifs);
+
+        if (!ifs) {
+            // Truncated manifest: rebuild everything rather than trust a prefix
+            entries.clear();
+            return false;
+        }
+        entries[entry.sourcePath] = std::move(entry);
+    }
+
+    return true;
+}
+
+void BuildManifest::save(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary);
+        if (!ofs) {
+            throw std::runtime_error("Failed to write manifest: " + tmpPath);
+        }
+
+        ofs.write(kManifestMagic, sizeof(kManifestMagic));
+        writeBytes(ofs, kManifestVersion);
+        writeBytes(ofs, static_cast<uint32_t>(entries.size()));
+
+        for (const auto& item : entries) {
+            const ManifestEntry& entry = item.second;
+            writeShortString(ofs, entry.sourcePath);
+            writeShortString(ofs, entry.outputPath);
+            writeBytes(ofs, entry.sourceSize);
+            writeBytes(ofs, entry.sourceMtime);
+            writeBytes(ofs, entry.settingsHash);
+            writeBytes(ofs, entry.outputSize);
+        }
+
+        if (!ofs) {
+            throw std::runtime_error("Failed to write manifest: " + tmpPath);
+        }
+    }
+
+    fs::rename(tmpPath, path);
+}
+
+bool BuildManifest::isUpToDate(const std::string& source, uint64_t size, int64_t mtime,
+                               uint64_t settingsHash, const std::string& output) const {
+    ManifestEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(source);
+        if (it == entries.end()) {
+            return false;
+        }
+        entry = it->second;
+    }
+
+    if (entry.sourceSize != size || entry.sourceMtime != mtime ||
+        entry.settingsHash != settingsHash || entry.outputPath != output) {
+        return false;
+    }
+
+    // One stat of the output; its content is not read
+    std::error_code ec;
+    uintmax_t outputSize = fs::file_size(output, ec);
+    return !ec && outputSize == entry.outputSize;
+}
+
+void BuildManifest::record(const ManifestEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[entry.sourcePath] = entry;
+}
+
+std::vector<ManifestEntry> BuildManifest::pruneMissing(const std::unordered_set<std::string>& seen) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ManifestEntry> removed;
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        std::error_code ec;
+        if (seen.count(it->first) == 0 && !fs::exists(it->first, ec)) {
+            removed.push_back(std::move(it->second));
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    return removed;
+}
+
+size_t BuildManifest::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+
+#ifdef __linux__
+#include <filesystem>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace arma3 {
+
+namespace {
+
+thread_local bool threadPinned = false;
+
+#ifdef __linux__
+
+namespace fs = std::filesystem;
+
+int readInt(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value = fallback;
+    if (!(in >> value)) {
+        return fallback;
+    }
+    return value;
+}
+
+// sysfs CPU list, e.g. "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        std::string range = list.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception&) {
+            // blank line or trailing separator
+        }
+        if (end == std::string::npos) break;
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+CpuTopology detect() {
+    CpuTopology topology;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return topology;
+    }
+
+    std::map<int, int> nodeByCpu;
+    std::error_code ec;
+    for (fs::directory_iterator it("/sys/devices/system/node", ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.size() < 5 || name.compare(0, 4, "node") != 0 ||
+            name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+        int node = std::stoi(name.substr(4));
+        std::ifstream in(it->path() / "cpulist");
+        std::string list;
+        std::getline(in, list);
+        for (int cpu : parseCpuList(list)) {
+            nodeByCpu[cpu] = node;
+        }
+    }
+
+    std::map<std::pair<int, int>, int> threadsPerCore;
+    std::set<int> nodes;
+    for (int id = 0; id < CPU_SETSIZE; id++) {
+        if (!CPU_ISSET(id, &allowed)) continue;
+
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+        CpuTopology::Cpu cpu;
+        cpu.id = id;
+        auto node = nodeByCpu.find(id);
+        cpu.node = node == nodeByCpu.end() ? 0 : node->second;
+        cpu.package = readInt(base + "physical_package_id", 0);
+        cpu.core = readInt(base + "core_id", id);
+        cpu.sibling = threadsPerCore[{cpu.package, cpu.core}]++;
+        nodes.insert(cpu.node);
+        topology.cpus.push_back(cpu);
+    }
+    topology.nodeCount = std::max<int>(1, static_cast<int>(nodes.size()));
+    return topology;
+}
+
+#else
+
+CpuTopology detect() {
+    return CpuTopology();
+}
+
+#endif
+
+} // namespace
+
+const CpuTopology& CpuTopology::get() {
+    static const CpuTopology topology = detect();
+    return topology;
+}
+
+int CpuTopology::nodeOf(int cpu) const {
+    for (const auto& c : cpus) {
+        if (c.id == cpu) return c.node;
+    }
+    return -1;
+}
+
+std::vector<int> CpuTopology::placement(size_t workers) const {
+    std::vector<int> result;
+    if (cpus.empty()) {
+        return result;
+    }
+
+    std::map<int, std::vector<Cpu>> byNode;
+    for (const auto& cpu : cpus) {
+        byNode[cpu.node].push_back(cpu);
+    }
+
+    std::vector<const std::vector<Cpu>*> nodes;
+    for (auto& [node, list] : byNode) {
+        // First hardware thread of every core, then the second, ...
+        std::sort(list.begin(), list.end(), [](const Cpu& a, const Cpu& b) {
+            if (a.sibling != b.sibling) return a.sibling < b.sibling;
+            if (a.package != b.package) return a.package < b.package;
+            if (a.core != b.core) return a.core < b.core;
+            return a.id < b.id;
+        });
+        nodes.push_back(&list);
+    }
+
+    result.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        const std::vector<Cpu>& list = *nodes[i % nodes.size()];
+        result.push_back(list[(i / nodes.size()) % list.size()].id);
+    }
+    return result;
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 0 is the calling thread, not the process
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        return false;
+    }
+    threadPinned = true;
+    return true;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool currentThreadPinned() {
+    return threadPinned;
+}
+
+int currentNode() {
+#ifdef __linux__
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return -1;
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "file_discovery.h"
+#include "thread_pool.h"
+
+#include <cctype>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace arma3 {
+
+namespace {
+
+std::vector<std::string> splitPath(const std::string& path) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (char ch : path) {
+        if (ch == '/' || ch == '\\') {
+            if (!current.empty() && current != ".") parts.push_back(current);
+            current.clear();
+        } else {
+            current += ch;
+        }
+    }
+    if (!current.empty() && current != ".") parts.push_back(current);
+    return parts;
+}
+
+bool hasWildcard(const std::string& segment) {
+    return segment.find_first_of("*?[") != std::string::npos;
+}
+
+inline bool sameChar(char a, char b) {
+#ifdef _WIN32
+    return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+#else
+    return a == b;
+#endif
+}
+
+// Match `[...]` at pattern[p]; advances p past the class
+bool matchClass(const std::string& pattern, size_t& p, char ch) {
+    size_t i = p + 1;
+    bool negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negate) i++;
+
+    bool matched = false;
+    bool first = true;
+    for (; i < pattern.size() && (first || pattern[i] != ']'); i++, first = false) {
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            if (ch >= pattern[i] && ch <= pattern[i + 2]) matched = true;
+            i += 2;
+        } else if (sameChar(pattern[i], ch)) {
+            matched = true;
+        }
+    }
+
+    p = i < pattern.size() ? i + 1 : i;
+    return matched != negate;
+}
+
+// Single path component; iterative with one backtrack point per `*`
+bool matchSegment(const std::string& pattern, const std::string& text) {
+    size_t p = 0, t = 0;
+    size_t starP = std::string::npos, starT = 0;
+
+    while (t < text.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starT = t;
+        } else if (p < pattern.size() && pattern[p] == '[') {
+            size_t next = p;
+            if (matchClass(pattern, next, text[t])) {
+                p = next;
+                t++;
+            } else if (starP != std::string::npos) {
+                p = starP + 1;
+                t = ++starT;
+            } else {
+                return false;
+            }
+        } else if (p < pattern.size() && (pattern[p] == '?' || sameChar(pattern[p], text[t]))) {
+            p++;
+            t++;
+        } else if (starP != std::string::npos) {
+            p = starP + 1;
+            t = ++starT;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+bool matchFrom(const std::vector<std::string>& pattern, size_t pi,
+               const std::vector<std::string>& path, size_t si) {
+    if (pi == pattern.size()) {
+        return si == path.size();
+    }
+    if (pattern[pi] == "**") {
+        return matchFrom(pattern, pi + 1, path, si) ||
+               (si < path.size() && matchFrom(pattern, pi, path, si + 1));
+    }
+    return si < path.size() && matchSegment(pattern[pi], path[si]) &&
+           matchFrom(pattern, pi + 1, path, si + 1);
+}
+
+bool prefixFrom(const std::vector<std::string>& pattern, size_t pi,
+                const std::vector<std::string>& dir, size_t si) {
+    if (si == dir.size()) {
+        // A file inside needs at least one more pattern component
+        return pi < pattern.size();
+    }
+    if (pi == pattern.size()) {
+        return false;
+    }
+    if (pattern[pi] == "**") {
+        return true;
+    }
+    return matchSegment(pattern[pi], dir[si]) && prefixFrom(pattern, pi + 1, dir, si + 1);
+}
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+    return dir.empty() || dir == "." ? name : dir + "/" + name;
+}
+
+} // namespace
+
+GlobPattern::GlobPattern(const std::string& pattern) {
+    std::vector<std::string> parts = splitPath(pattern);
+    bool absolute = !pattern.empty() && (pattern[0] == '/' || pattern[0] == '\\');
+
+    size_t firstWild = 0;
+    while (firstWild + 1 < parts.size() && !hasWildcard(parts[firstWild])) {
+        firstWild++;
+    }
+
+    for (size_t i = 0; i < firstWild; i++) {
+        base = i == 0 ? parts[i] : base + "/" + parts[i];
+    }
+    if (absolute) base = "/" + base;
+    if (base.empty()) base = ".";
+
+    segments.assign(parts.begin() + firstWild, parts.end());
+}
+
+bool GlobPattern::matches(const std::string& relativePath) const {
+    return matchFrom(segments, 0, splitPath(relativePath), 0);
+}
+
+bool GlobPattern::canMatchBelow(const std::string& relativeDir) const {
+    return prefixFrom(segments, 0, splitPath(relativeDir), 0);
+}
+
+void discoverFiles(const std::string& pattern, const std::function<void(const DiscoveredFile&)>& onFile,
+                   size_t threads) {
+    GlobPattern glob(pattern);
+    const std::string& base = glob.baseDirectory();
+
+    ThreadPool pool(threads);
+
+    // One task per directory; subdirectories fan out across the pool
+    std::function<void(const std::string&)> walk = [&](const std::string& relativeDir) {
+        std::error_code ec;
+        fs::directory_iterator it(relativeDir.empty() ? fs::path(base) : fs::path(base) / relativeDir,
+                                  fs::directory_options::skip_permission_denied, ec);
+
+        for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            std::string relative = joinPath(relativeDir, it->path().filename().string());
+
+            std::error_code typeEc;
+            if (it->is_directory(typeEc)) {
+                // Symlinked directories are not followed: a link to an
+                // ancestor would otherwise recurse until paths get too long
+                if (!it->is_symlink(typeEc) && glob.canMatchBelow(relative)) {
+                    pool.submit([&walk, relative]() { walk(relative); });
+                }
+            } else if (it->is_regular_file(typeEc) && glob.matches(relative)) {
+                onFile(DiscoveredFile{joinPath(base, relative), relative});
+            }
+        }
+    };
+
+    pool.submit([&walk]() { walk(""); });
+    pool.wait();
+}
+
+void readNulSeparatedList(std::istream& input, const std::function<void(const DiscoveredFile&)>& onFile) {
+    const fs::path cwd = fs::current_path();
+    std::string path;
+    while (std::getline(input, path, '\0')) {
+        if (path.empty()) continue;
+        fs::path p(path);
+        // Normalised first, so no ".." survives into the relative path
+        fs::path absolute = fs::absolute(p).lexically_normal();
+        fs::path relative = absolute.lexically_relative(cwd);
+        if (relative.empty() || *relative.begin() == "..") {
+            relative = absolute.relative_path();
+        }
+        onFile(DiscoveredFile{p.generic_string(), relative.generic_string()});
+    }
+}
+
+} // namespace arma3
\ No newline at end of file
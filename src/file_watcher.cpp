@@ -0,0 +1,266 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace arma3 {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr uint32_t DirectoryMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE |
+                                   IN_ONLYDIR | IN_EXCL_UNLINK;
+
+std::string joinPath(const std::string& directory, const char* name) {
+    return directory.empty() || directory.back() == '/' ? directory + name : directory + "/" + name;
+}
+
+bool isBelow(const std::string& path, const std::string& directory) {
+    return path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0 &&
+           path[directory.size()] == '/';
+}
+
+} // namespace
+
+FileWatcher::FileWatcher(const std::string& rootDirectory, std::chrono::milliseconds debounceDelay)
+    : root(fs::path(rootDirectory).lexically_normal().generic_string()), debounce(debounceDelay) {
+    if (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+    }
+    if (!fs::is_directory(root)) {
+        throw std::runtime_error("Not a directory: " + rootDirectory);
+    }
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        throw std::runtime_error(std::string("inotify_init1 failed: ") + std::strerror(errno));
+    }
+    if (pipe2(wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        int error = errno;
+        close(inotifyFd);
+        throw std::runtime_error(std::string("pipe2 failed: ") + std::strerror(error));
+    }
+
+    try {
+        addTree(root, false);
+    }
+    catch (...) {
+        close(inotifyFd);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        throw;
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    close(inotifyFd);
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+}
+
+void FileWatcher::addTree(const std::string& directory, bool reportFiles) {
+    // Watch first, then list: anything created in between shows up in both,
+    // and the debounce merges the duplicates
+    int wd = inotify_add_watch(inotifyFd, directory.c_str(), DirectoryMask);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            throw std::runtime_error("Out of inotify watches (raise fs.inotify.max_user_watches)");
+        }
+        return;  // vanished or unreadable; nothing to watch
+    }
+    // Re-adding a moved directory returns its existing descriptor
+    directories[wd] = directory;
+
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code typeError;
+        std::string path = it->path().generic_string();
+        if (it->is_directory(typeError) && !it->is_symlink(typeError)) {
+            addTree(path, reportFiles);
+        } else if (reportFiles && it->is_regular_file(typeError)) {
+            touch(path, WatchEvent::Kind::Changed);
+        }
+    }
+}
+
+void FileWatcher::removeTree(const std::string& directory) {
+    for (auto it = directories.begin(); it != directories.end();) {
+        if (it->second == directory || isBelow(it->second, directory)) {
+            inotify_rm_watch(inotifyFd, it->first);
+            it = directories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FileWatcher::rescan() {
+    // Their IN_IGNORED may have been among the lost events
+    for (auto it = directories.begin(); it != directories.end();) {
+        std::error_code ec;
+        if (!fs::is_directory(it->second, ec)) {
+            inotify_rm_watch(inotifyFd, it->first);
+            it = directories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // Already watched directories keep their descriptor; files are left to
+    // the caller's own rescan
+    addTree(root, false);
+}
+
+void FileWatcher::touch(const std::string& path, WatchEvent::Kind kind) {
+    // The last event of a burst decides: delete + rename-into-place is a change
+    pending[path] = {kind, Clock::now() + debounce};
+}
+
+void FileWatcher::readEvents() {
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    for (;;) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            return;  // EAGAIN: drained
+        }
+        if (length == 0) {
+            return;
+        }
+
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                directories.erase(event->wd);
+                continue;
+            }
+
+            auto dir = directories.find(event->wd);
+            if (dir == directories.end() || event->len == 0) {
+                continue;
+            }
+            std::string path = joinPath(dir->second, event->name);
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addTree(path, true);
+                } else if (event->mask & IN_MOVED_FROM) {
+                    removeTree(path);
+                }
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                touch(path, WatchEvent::Kind::Changed);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                touch(path, WatchEvent::Kind::Removed);
+            }
+        }
+    }
+}
+
+bool FileWatcher::wait(std::vector<WatchEvent>& events) {
+    for (;;) {
+        if (interrupted.load()) {
+            return false;
+        }
+
+        int timeout = -1;
+        if (!pending.empty()) {
+            auto due = std::min_element(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+                return a.second.due < b.second.due;
+            })->second.due;
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - Clock::now()).count();
+            timeout = static_cast<int>(std::max<long long>(0, wait + 1));
+        }
+
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+
+        bool woken = false;
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            char drain[64];
+            while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+            }
+            woken = true;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            readEvents();
+        }
+
+        if (overflowed) {
+            overflowed = false;
+            pending.clear();
+            events.push_back({WatchEvent::Kind::Rescan, root});
+        }
+
+        auto now = Clock::now();
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.due <= now) {
+                events.push_back({it->second.kind, it->first});
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (!events.empty() || woken) {
+            return !interrupted.load();
+        }
+    }
+}
+
+void FileWatcher::wake() {
+    char byte = 1;
+    ssize_t ignored = write(wakePipe[1], &byte, 1);
+    (void)ignored;
+}
+
+void FileWatcher::interrupt() {
+    interrupted.store(true);
+    wake();
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::string& rootDirectory, std::chrono::milliseconds debounceDelay)
+    : root(rootDirectory), debounce(debounceDelay) {
+    throw std::runtime_error("Watch mode needs inotify and is only available on Linux");
+}
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::wait(std::vector<WatchEvent>&) {
+    return false;
+}
+
+void FileWatcher::rescan() {}
+
+void FileWatcher::wake() {}
+
+void FileWatcher::interrupt() {
+    interrupted.store(true);
+}
+
+#endif
+
+} // namespace arma3
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "paa.h"
 #include "image_loader.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "thumbnail_cache.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -12,30 +15,64 @@
 #include <string>
 #include <filesystem>
 #include <chrono>
-#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
+enum class JobState {
+    Pending,
+    Running,
+    Succeeded,
+    Failed,
+    Cancelled
+};
+
+// Owned by the UI thread, worked on by exactly one pool thread.
+// Plain fields are written by the worker before `state` is published with
+// release semantics, so the UI may read them once it observes a final state.
 struct ConversionJob {
     std::string inputPath;
     std::string outputPath;
-    bool completed = false;
-    bool success = false;
+    std::atomic<JobState> state{JobState::Pending};
+    arma3::ConversionProgress progress;
     std::string errorMessage;
+    bool previewRefreshed = false;  // UI thread only
     int64_t durationMs = 0;
     uint32_t width = 0;
     uint32_t height = 0;
+
+    bool finished() const {
+        JobState s = state.load(std::memory_order_acquire);
+        return s != JobState::Pending && s != JobState::Running;
+    }
+
+    float fraction() const {
+        uint64_t total = progress.bytesTotal.load(std::memory_order_relaxed);
+        if (total == 0) return 0.0f;
+        return static_cast<float>(progress.bytesProcessed.load(std::memory_order_relaxed)) / total;
+    }
 };
 
 class PAAConverterApp {
 public:
-    PAAConverterApp() : selectedFormat(0), isConverting(false) {
+    PAAConverterApp() : selectedFormat(0) {
         formatNames[0] = "Auto (DXT1/DXT5)";
         formatNames[1] = "DXT1 (No Alpha)";
         formatNames[2] = "DXT5 (With Alpha)";
+        formatNames[3] = "DXT3 (Sharp Alpha)";
+    }
+
+    ~PAAConverterApp() {
+        // Stop in-flight encodes; the pool joins before the jobs are freed
+        cancelConversion();
     }
 
     void render() {
+        thumbnails.processUploads();
+
         // Make window fill the entire viewport
         ImGuiViewport* viewport = ImGui::GetMainViewport();
         ImGui::SetNextWindowPos(viewport->WorkPos);
@@ -56,8 +93,7 @@ public:
         ImGui::SameLine();
         ImGui::TextDisabled("(Drag & drop files here)");
 
-        ImGui::InputTextMultiline("##files", fileListBuffer, sizeof(fileListBuffer),
-            ImVec2(-1, 100), ImGuiInputTextFlags_ReadOnly);
+        renderFileList();
 
         if (ImGui::Button("Add Files...")) {
             openFileDialog();
@@ -65,14 +101,16 @@ public:
 
         ImGui::SameLine();
         if (ImGui::Button("Clear")) {
-            fileListBuffer[0] = '\0';
             inputFiles.clear();
         }
 
         // Format selection
         ImGui::Spacing();
         ImGui::Text("Output Format:");
-        ImGui::Combo("##format", &selectedFormat, formatNames, 3);
+        ImGui::Combo("##format", &selectedFormat, formatNames, 4);
+
+        ImGui::Text("Mip Filter:");
+        ImGui::Combo("##mipfilter", &selectedMipFilter, mipFilterNames, 3);
 
         // Output directory
         ImGui::Spacing();
@@ -91,6 +129,12 @@ public:
 
         // Convert button
         ImGui::Spacing();
+        bool isConverting = remainingJobs.load(std::memory_order_acquire) > 0;
+        if (wasConverting && !isConverting) {
+            conversionEnd = std::chrono::steady_clock::now();
+        }
+        wasConverting = isConverting;
+
         bool canConvert = !isConverting && !inputFiles.empty();
         if (!canConvert) ImGui::BeginDisabled();
 
@@ -100,20 +144,40 @@ public:
 
         if (!canConvert) ImGui::EndDisabled();
 
+        if (isConverting) {
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel", ImVec2(120, 40))) {
+                cancelConversion();
+            }
+        }
+
         ImGui::SameLine();
         ImGui::Text("Files: %zu", inputFiles.size());
 
         // Progress section
-        if (isConverting || !conversionJobs.empty()) {
+        if (!conversionJobs.empty()) {
             ImGui::Separator();
             ImGui::Text("Progress:");
 
+            int completed = completedJobs.load(std::memory_order_acquire);
+            uint64_t bytesDone = 0;
+            for (const auto& job : conversionJobs) {
+                bytesDone += job->progress.bytesProcessed.load(std::memory_order_relaxed);
+            }
+
+            auto elapsedEnd = isConverting ? std::chrono::steady_clock::now() : conversionEnd;
+            double seconds = std::chrono::duration<double>(elapsedEnd - conversionStart).count();
+            double throughput = seconds > 0.0 ? bytesDone / (1024.0 * 1024.0) / seconds : 0.0;
+
             if (isConverting) {
-                ImGui::ProgressBar(currentProgress, ImVec2(-1, 0));
-                ImGui::Text("Converting %d/%zu files...", completedJobs + 1, conversionJobs.size());
+                float overall = static_cast<float>(completed) / conversionJobs.size();
+                ImGui::ProgressBar(overall, ImVec2(-1, 0));
+                ImGui::Text("Converting %d/%zu files on %zu threads... %.1f MB/s",
+                    completed, conversionJobs.size(), pool.size(), throughput);
             } else {
-                ImGui::Text("Conversion complete!");
-                ImGui::Text("Successful: %d | Failed: %d", successCount, failCount);
+                ImGui::Text(cancelRequested ? "Conversion cancelled." : "Conversion complete!");
+                ImGui::Text("Successful: %d | Failed: %d | %.1f MB/s",
+                    successCount.load(), failCount.load(), throughput);
             }
 
             // Results table
@@ -126,16 +190,35 @@ public:
             ImGui::Text("Status"); ImGui::NextColumn();
             ImGui::Separator();
 
-            for (const auto& job : conversionJobs) {
-                if (!job.completed) continue;
+            for (const auto& jobPtr : conversionJobs) {
+                ConversionJob& job = *jobPtr;
+                JobState state = job.state.load(std::memory_order_acquire);
+                if (state == JobState::Pending) continue;
+
+                // Rewritten output: drop the stale PAA preview
+                if (state == JobState::Succeeded && !job.previewRefreshed) {
+                    thumbnails.invalidate(job.outputPath, arma3::ThumbnailSource::PAA);
+                    job.previewRefreshed = true;
+                }
 
                 fs::path p(job.inputPath);
                 ImGui::Text("%s", p.filename().string().c_str()); ImGui::NextColumn();
-                ImGui::Text("%dx%d", job.width, job.height); ImGui::NextColumn();
-                ImGui::Text("%lldms", job.durationMs); ImGui::NextColumn();
 
-                if (job.success) {
+                if (state == JobState::Running) {
+                    ImGui::Text("-"); ImGui::NextColumn();
+                    ImGui::Text("-"); ImGui::NextColumn();
+                    ImGui::ProgressBar(job.fraction(), ImVec2(-1, 0));
+                    ImGui::NextColumn();
+                    continue;
+                }
+
+                ImGui::Text("%ux%u", job.width, job.height); ImGui::NextColumn();
+                ImGui::Text("%lldms", static_cast<long long>(job.durationMs)); ImGui::NextColumn();
+
+                if (state == JobState::Succeeded) {
                     ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Success");
+                } else if (state == JobState::Cancelled) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.0f, 1.0f), "Cancelled");
                 } else {
                     ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Failed");
                     if (ImGui::IsItemHovered()) {
@@ -172,8 +255,6 @@ public:
                 inputFiles.push_back(file);
             }
         }
-
-        updateFileListBuffer();
     }
 
     void openFileDialog() {
@@ -192,7 +273,6 @@ public:
             for (const auto& file : files) {
                 inputFiles.push_back(file);
             }
-            updateFileListBuffer();
         }
     }
 
@@ -207,85 +287,194 @@ public:
         }
     }
 
+    // Keep a Prometheus text file of conversion metrics up to date while
+    // the window is open (--metrics <file>)
+    void startMetrics(const std::string& path, std::chrono::milliseconds interval) {
+        metrics = std::make_unique<arma3::MetricsExporter>(path, interval, [this]() {
+            arma3::MetricsGauges gauges;
+            gauges.queueDepth = pool.pendingTasks();
+            gauges.workers = pool.size();
+            return gauges;
+        });
+    }
+
 private:
-    void updateFileListBuffer() {
-        std::string text;
-        for (const auto& file : inputFiles) {
-            text += file + "\n";
+    std::string outputPathFor(const std::string& input) const {
+        std::string outDir = outputDir[0] != '\0' ? outputDir : fs::path(input).parent_path().string();
+        return (fs::path(outDir) / (fs::path(input).stem().string() + ".paa")).string();
+    }
+
+    void renderThumbnail(const std::string& path, arma3::ThumbnailSource source) {
+        const float size = static_cast<float>(kThumbnailDisplaySize);
+        const arma3::Thumbnail* thumb = thumbnails.request(path, source);
+
+        if (!thumb || thumb->texture == 0) {
+            ImGui::Dummy(ImVec2(size, size));
+            return;
         }
-        strncpy(fileListBuffer, text.c_str(), sizeof(fileListBuffer) - 1);
+
+        // Fit into a square cell, keeping the aspect ratio
+        float scale = size / std::max(thumb->width, thumb->height);
+        ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(thumb->texture)),
+            ImVec2(thumb->width * scale, thumb->height * scale));
+
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s\n%ux%u preview", path.c_str(), thumb->width, thumb->height);
+        }
+    }
+
+    void renderFileList() {
+        ImGui::BeginChild("##files", ImVec2(-1, 220), true);
+
+        // Only visible rows request previews, so long lists cost nothing extra
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(inputFiles.size()),
+            kThumbnailDisplaySize + ImGui::GetTextLineHeightWithSpacing() * 0.5f);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const std::string& input = inputFiles[i];
+                ImGui::PushID(i);
+                renderThumbnail(input, arma3::ThumbnailSource::Image);
+                ImGui::SameLine();
+                renderThumbnail(outputPathFor(input), arma3::ThumbnailSource::PAA);
+                ImGui::SameLine();
+                ImGui::AlignTextToFramePadding();
+                ImGui::Text("%s", input.c_str());
+                ImGui::PopID();
+            }
+        }
+        clipper.End();
+
+        ImGui::EndChild();
     }
 
     void startConversion() {
         conversionJobs.clear();
-        isConverting = true;
         completedJobs = 0;
         successCount = 0;
         failCount = 0;
+        cancelRequested = false;
+        conversionStart = std::chrono::steady_clock::now();
+
+        arma3::PAAFormat format = arma3::PAAFormat::UNKNOWN;
+        if (selectedFormat == 1) format = arma3::PAAFormat::DXT1;
+        else if (selectedFormat == 2) format = arma3::PAAFormat::DXT5;
+        else if (selectedFormat == 3) format = arma3::PAAFormat::DXT3;
+
+        arma3::MipSettings mipSettings;
+        mipSettings.filter = static_cast<arma3::MipFilter>(selectedMipFilter);
 
         for (const auto& input : inputFiles) {
-            ConversionJob job;
-            job.inputPath = input;
+            auto job = std::make_unique<ConversionJob>();
+            job->inputPath = input;
 
-            std::string outDir = outputDir[0] != '\0' ? outputDir : fs::path(input).parent_path().string();
-            job.outputPath = (fs::path(outDir) / (fs::path(input).stem().string() + ".paa")).string();
+            job->outputPath = outputPathFor(input);
 
-            conversionJobs.push_back(job);
+            conversionJobs.push_back(std::move(job));
         }
 
-        // Start conversion in background thread
-        std::thread([this]() {
-            for (size_t i = 0; i < conversionJobs.size(); i++) {
-                auto& job = conversionJobs[i];
+        // The job list is not touched again until remainingJobs drops to zero
+        remainingJobs.store(static_cast<int>(conversionJobs.size()), std::memory_order_release);
 
-                try {
-                    auto start = std::chrono::high_resolution_clock::now();
+        for (auto& jobPtr : conversionJobs) {
+            ConversionJob* job = jobPtr.get();
+            pool.submit([this, job, format, mipSettings]() { runJob(*job, format, mipSettings); });
+        }
+    }
 
-                    arma3::PAA paa;
-                    paa.loadImage(job.inputPath);
+    void runJob(ConversionJob& job, arma3::PAAFormat format, const arma3::MipSettings& mipSettings) {
+        JobState result = JobState::Failed;
 
-                    arma3::PAAFormat format = arma3::PAAFormat::UNKNOWN;
-                    if (selectedFormat == 1) format = arma3::PAAFormat::DXT1;
-                    else if (selectedFormat == 2) format = arma3::PAAFormat::DXT5;
+        if (job.progress.cancelled.load(std::memory_order_relaxed)) {
+            result = JobState::Cancelled;
+            arma3::recordFailure(arma3::FailureCause::Cancelled);
+        } else {
+            job.state.store(JobState::Running, std::memory_order_release);
+            arma3::StageTimes stages;
+            arma3::StageRecorder recorder(stages);
+            arma3::WorkerBusyScope busy;
 
-                    job.width = paa.getMipMaps()[0].width;
-                    job.height = paa.getMipMaps()[0].height;
+            try {
+                auto start = std::chrono::high_resolution_clock::now();
 
-                    paa.writePAA(job.outputPath, format);
+                arma3::PAA paa;
+                paa.setProgress(&job.progress);
+                paa.setMipSettings(mipSettings);
+                paa.loadImage(job.inputPath);
 
-                    auto end = std::chrono::high_resolution_clock::now();
-                    job.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+                job.width = paa.getMipMaps()[0].width;
+                job.height = paa.getMipMaps()[0].height;
 
-                    job.success = true;
-                    successCount++;
-                }
-                catch (const std::exception& e) {
-                    job.success = false;
-                    job.errorMessage = e.what();
-                    failCount++;
-                }
+                paa.writePAA(job.outputPath, format);
 
-                job.completed = true;
-                completedJobs++;
-                currentProgress = static_cast<float>(completedJobs) / conversionJobs.size();
+                auto end = std::chrono::high_resolution_clock::now();
+                job.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+                std::error_code ec;
+                arma3::ConversionSample sample;
+                sample.pixels = static_cast<uint64_t>(job.width) * job.height;
+                sample.bytesWritten = fs::file_size(job.outputPath, ec);
+                sample.seconds = std::chrono::duration<double>(end - start).count();
+                sample.stages = stages;
+                arma3::recordConversion(sample);
+
+                result = JobState::Succeeded;
+            }
+            catch (const arma3::ConversionCancelled&) {
+                // Thrown while encoding, before writePAA opens the output, so
+                // an existing PAA from an earlier run is still intact
+                arma3::recordFailure(arma3::FailureCause::Cancelled);
+                result = JobState::Cancelled;
+            }
+            catch (const std::exception& e) {
+                job.errorMessage = e.what();
+                arma3::recordFailure(arma3::failureCauseFor(recorder.lastStage()));
+                result = JobState::Failed;
             }
+        }
+
+        if (result == JobState::Succeeded) successCount++;
+        else if (result == JobState::Failed) failCount++;
+
+        job.state.store(result, std::memory_order_release);
+        completedJobs++;
+        remainingJobs.fetch_sub(1, std::memory_order_acq_rel);
+    }
 
-            isConverting = false;
-        }).detach();
+    void cancelConversion() {
+        cancelRequested = true;
+        for (auto& job : conversionJobs) {
+            job->progress.cancelled.store(true, std::memory_order_relaxed);
+        }
     }
 
-    char fileListBuffer[4096] = {0};
+    static constexpr int kThumbnailDisplaySize = 48;
+
     char outputDir[256] = {0};
     int selectedFormat;
-    const char* formatNames[3];
+    const char* formatNames[4];
+    int selectedMipFilter = 0;  // index into arma3::MipFilter
+    const char* mipFilterNames[3] = {"Box (fast)", "Kaiser", "Lanczos"};
     std::vector<std::string> inputFiles;
 
-    bool isConverting;
-    int completedJobs = 0;
-    int successCount = 0;
-    int failCount = 0;
-    float currentProgress = 0.0f;
-    std::vector<ConversionJob> conversionJobs;
+    std::atomic<int> remainingJobs{0};
+    std::atomic<int> completedJobs{0};
+    std::atomic<int> successCount{0};
+    std::atomic<int> failCount{0};
+    bool cancelRequested = false;
+    bool wasConverting = false;
+    std::chrono::steady_clock::time_point conversionStart;
+    std::chrono::steady_clock::time_point conversionEnd;
+    std::vector<std::unique_ptr<ConversionJob>> conversionJobs;
+
+    // 64 MB of 128px previews is ~1000 textures
+    arma3::ThumbnailCache thumbnails{64 * 1024 * 1024, 128};
+
+    // Declared after the jobs so it is destroyed (and joined) before the jobs it references
+    arma3::ThreadPool pool;
+
+    // Reads the pool's gauges, so it goes first
+    std::unique_ptr<arma3::MetricsExporter> metrics;
 };
 
 static void glfw_error_callback(int error, const char* description) {
@@ -302,6 +491,21 @@ static void glfw_drop_callback(GLFWwindow* window, int count, const char** paths
 }
 
 int main(int argc, char** argv) {
+    // Parsed before any window exists, so a bad value just exits
+    std::string metricsPath;
+    std::chrono::milliseconds metricsInterval(10000);
+    try {
+        for (int i = 1; i + 1 < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--metrics") metricsPath = argv[++i];
+            else if (arg == "--metrics-interval") metricsInterval = arma3::parseMetricsInterval(argv[++i]);
+        }
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
     glfwSetErrorCallback(glfw_error_callback);
 
     if (!glfwInit()) {
@@ -342,9 +546,13 @@ int main(int argc, char** argv) {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
-    // Create app
-    PAAConverterApp app;
-    glfwSetWindowUserPointer(window, &app);
+    // Create app (owns GL textures, so it must go before the context)
+    auto app = std::make_unique<PAAConverterApp>();
+    glfwSetWindowUserPointer(window, app.get());
+
+    if (!metricsPath.empty()) {
+        app->startMetrics(metricsPath, metricsInterval);
+    }
     glfwSetDropCallback(window, glfw_drop_callback);
 
     // Main loop
@@ -357,7 +565,7 @@ int main(int argc, char** argv) {
         ImGui::NewFrame();
 
         // Render app
-        app.render();
+        app->render();
 
         // Rendering
         ImGui::Render();
@@ -372,6 +580,7 @@ int main(int argc, char** argv) {
     }
 
     // Cleanup
+    app.reset();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,238 @@
+#include "image_decoders.h"
+#include "buffer_pool.h"
+
+#include <png.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace arma3 {
+
+namespace {
+
+// ---- PNG ----
+
+struct PNGSource {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    char error[160];
+};
+
+void readFromMemory(png_structp png, png_bytep out, png_size_t count) {
+    auto* source = static_cast<PNGSource*>(png_get_io_ptr(png));
+    if (count > source->size - source->pos) {
+        png_error(png, "unexpected end of data");
+    }
+    std::memcpy(out, source->data + source->pos, count);
+    source->pos += count;
+}
+
+void onPNGError(png_structp png, png_const_charp message) {
+    auto* source = static_cast<PNGSource*>(png_get_error_ptr(png));
+    std::snprintf(source->error, sizeof(source->error), "%s", message);
+    png_longjmp(png, 1);
+}
+
+void onPNGWarning(png_structp, png_const_charp) {}
+
+// Every object with a destructor belongs to the caller, so the longjmp out
+// of libpng on an error never skips one
+bool readPNG(PNGSource& source, ImageData& image, std::vector<png_bytep>& rows) {
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &source, onPNGError, onPNGWarning);
+    if (!png) {
+        std::snprintf(source.error, sizeof(source.error), "out of memory");
+        return false;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    // stb_image checks neither CRCs nor the zlib checksum; skipping them
+    // takes a noticeable share off inflate
+    png_set_crc_action(png, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
+#ifdef PNG_IGNORE_ADLER32
+    png_set_option(png, PNG_IGNORE_ADLER32, PNG_OPTION_ON);
+#endif
+    // Inflate in large steps (sets the IDAT read size on read structs)
+    png_set_compression_buffer_size(png, 256 * 1024);
+    png_set_read_fn(png, &source, readFromMemory);
+    png_read_info(png, info);
+
+    // Everything becomes 8-bit RGBA inside libpng's per-row transforms,
+    // written straight into the output rows. 16-bit keeps the high byte,
+    // as stb_image does
+    png_set_strip_16(png);
+    png_set_expand(png);
+    png_set_gray_to_rgb(png);
+    png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    png_uint_32 width = png_get_image_width(png, info);
+    png_uint_32 height = png_get_image_height(png, info);
+    if (png_get_rowbytes(png, info) != static_cast<size_t>(width) * 4) {
+        png_error(png, "unsupported pixel layout");
+    }
+
+    image.width = width;
+    image.height = height;
+    resizeBuffer(image.data, static_cast<size_t>(width) * height * 4);
+    rows.resize(height);
+    for (png_uint_32 y = 0; y < height; y++) {
+        rows[y] = image.data.data() + static_cast<size_t>(y) * width * 4;
+    }
+
+    // Trailing chunks are not read; they can't change the pixels
+    png_read_image(png, rows.data());
+    png_destroy_read_struct(&png, &info, nullptr);
+    return true;
+}
+
+// ---- TGA ----
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+[[noreturn]] void corruptTGA() {
+    throw std::runtime_error("Corrupt TGA: pixel data runs past end of file");
+}
+
+// BGR(A) or grey to RGBA, one pass
+void convertTGAPixels(const uint8_t* src, uint8_t* dst, size_t count, size_t bytesPerPixel) {
+    switch (bytesPerPixel) {
+        case 4:
+            for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+                dst[3] = src[3];
+            }
+            break;
+        case 3:
+            for (size_t i = 0; i < count; i++, src += 3, dst += 4) {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+                dst[3] = 255;
+            }
+            break;
+        default:
+            for (size_t i = 0; i < count; i++, src += 1, dst += 4) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+            }
+            break;
+    }
+}
+
+} // namespace
+
+bool decodePNGNative(const uint8_t* data, size_t size, ImageData& image) {
+    if (size < 8 || png_sig_cmp(data, 0, 8) != 0) {
+        return false;
+    }
+
+    PNGSource source{data, size, 0, {}};
+    std::vector<png_bytep> rows;
+    if (!readPNG(source, image, rows)) {
+        throw std::runtime_error(std::string("Corrupt PNG: ") + source.error);
+    }
+    return true;
+}
+
+bool decodeTGANative(const uint8_t* data, size_t size, ImageData& image) {
+    if (size < 18) {
+        return false;
+    }
+
+    const uint8_t idLength = data[0];
+    const uint8_t colorMapType = data[1];
+    const uint8_t imageType = data[2];
+    const uint32_t width = le16(data + 12);
+    const uint32_t height = le16(data + 14);
+    const uint8_t bitsPerPixel = data[16];
+    const uint8_t descriptor = data[17];
+
+    const bool trueColor = imageType == 2 || imageType == 10;
+    const bool grey = imageType == 3 || imageType == 11;
+    const bool rle = imageType == 10 || imageType == 11;
+
+    // Paletted, 16-bit and right-to-left files are left to stb_image
+    if (colorMapType != 0 || !(trueColor || grey) ||
+        (trueColor && bitsPerPixel != 24 && bitsPerPixel != 32) ||
+        (grey && bitsPerPixel != 8) ||
+        (descriptor & 0x10) != 0 || width == 0 || height == 0) {
+        return false;
+    }
+
+    const size_t bytesPerPixel = bitsPerPixel / 8;
+    const bool topDown = (descriptor & 0x20) != 0;
+    size_t pos = 18 + idLength;
+    if (pos > size) {
+        corruptTGA();
+    }
+
+    image.width = width;
+    image.height = height;
+    resizeBuffer(image.data, static_cast<size_t>(width) * height * 4);
+    auto row = [&](uint32_t y) {
+        return image.data.data() + static_cast<size_t>(topDown ? y : height - 1 - y) * width * 4;
+    };
+
+    if (!rle) {
+        size_t rowBytes = width * bytesPerPixel;
+        if (rowBytes * height > size - pos) {
+            corruptTGA();
+        }
+        for (uint32_t y = 0; y < height; y++, pos += rowBytes) {
+            convertTGAPixels(data + pos, row(y), width, bytesPerPixel);
+        }
+        return true;
+    }
+
+    // Packets may span rows
+    uint32_t packetLeft = 0;
+    bool runPacket = false;
+    uint8_t runPixel[4];
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* dst = row(y);
+        uint32_t x = 0;
+        while (x < width) {
+            if (packetLeft == 0) {
+                if (pos >= size) corruptTGA();
+                uint8_t header = data[pos++];
+                packetLeft = (header & 0x7F) + 1u;
+                runPacket = (header & 0x80) != 0;
+                if (runPacket) {
+                    if (bytesPerPixel > size - pos) corruptTGA();
+                    convertTGAPixels(data + pos, runPixel, 1, bytesPerPixel);
+                    pos += bytesPerPixel;
+                }
+            }
+
+            uint32_t count = std::min(packetLeft, width - x);
+            uint8_t* out = dst + static_cast<size_t>(x) * 4;
+            if (runPacket) {
+                for (uint32_t i = 0; i < count; i++, out += 4) {
+                    std::memcpy(out, runPixel, 4);
+                }
+            } else {
+                if (count * bytesPerPixel > size - pos) corruptTGA();
+                convertTGAPixels(data + pos, out, count, bytesPerPixel);
+                pos += count * bytesPerPixel;
+            }
+            x += count;
+            packetLeft -= count;
+        }
+    }
+    return true;
+}
+
+} // namespace arma3
\ No newline at end of file
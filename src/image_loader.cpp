@@ -1,4 +1,6 @@
 #include "image_loader.h"
+#include "buffer_pool.h"
+#include "image_decoders.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -6,46 +8,95 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
-#include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
 
 namespace arma3 {
 
-ImageData ImageLoader::loadPNG(const std::string& filename) {
-    int width, height, channels;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+namespace {
 
-    if (!data) {
-        throw std::runtime_error("Failed to load PNG: " + filename);
-    }
+std::atomic<ImageDecoder> activeDecoder{ImageDecoder::Native};
 
-    ImageData img;
-    img.width = width;
-    img.height = height;
-    img.data = std::vector<uint8_t>(data, data + (width * height * 4));
+bool hasExtension(const std::string& name, const char* extension) {
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string ext = name.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == extension;
+}
 
-    stbi_image_free(data);
-    return img;
+std::vector<uint8_t> readWholeFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Failed to load image: " + filename + " - can't open file");
+    }
+    std::vector<uint8_t> bytes = acquireBuffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+        throw std::runtime_error("Failed to load image: " + filename + " - read error");
+    }
+    return bytes;
 }
 
-ImageData ImageLoader::loadTGA(const std::string& filename) {
+void decodeWithStb(const uint8_t* bytes, size_t size, const std::string& name, ImageData& image) {
     int width, height, channels;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+    unsigned char* data = stbi_load_from_memory(bytes, static_cast<int>(size), &width, &height, &channels, 4);
 
     if (!data) {
-        throw std::runtime_error("Failed to load TGA: " + filename);
+        throw std::runtime_error("Failed to load image: " + name + " - " + stbi_failure_reason());
     }
 
-    ImageData img;
-    img.width = width;
-    img.height = height;
-    img.data = std::vector<uint8_t>(data, data + (width * height * 4));
-
+    image.width = width;
+    image.height = height;
+    resizeBuffer(image.data, static_cast<size_t>(width) * height * 4);
+    std::memcpy(image.data.data(), data, image.data.size());
     stbi_image_free(data);
-    return img;
+}
+
+} // namespace
+
+const char* imageDecoderName(ImageDecoder decoder) {
+    return decoder == ImageDecoder::Stb ? "stb" : "native";
+}
+
+ImageDecoder parseImageDecoder(const std::string& name) {
+    if (name == "stb") return ImageDecoder::Stb;
+    if (name == "native" || name == "libpng") return ImageDecoder::Native;
+    throw std::runtime_error("Unknown image decoder: " + name + " (stb, native)");
+}
+
+void ImageLoader::setDecoder(ImageDecoder decoder) {
+    activeDecoder.store(decoder, std::memory_order_relaxed);
+}
+
+ImageDecoder ImageLoader::decoder() {
+    return activeDecoder.load(std::memory_order_relaxed);
+}
+
+ImageData ImageLoader::loadPNG(const std::string& filename) {
+    return load(filename);
+}
+
+ImageData ImageLoader::loadTGA(const std::string& filename) {
+    return load(filename);
 }
 
 ImageData ImageLoader::load(const std::string& filename) {
+    ImageData img;
+
+    if (decoder() == ImageDecoder::Native) {
+        std::vector<uint8_t> bytes = readWholeFile(filename);
+        decodeInto(bytes.data(), bytes.size(), filename, img);
+        recycleBuffer(std::move(bytes));
+        return img;
+    }
+
     // stb_image auto-detects format
     int width, height, channels;
     unsigned char* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
@@ -54,15 +105,94 @@ ImageData ImageLoader::load(const std::string& filename) {
         throw std::runtime_error("Failed to load image: " + filename + " - " + stbi_failure_reason());
     }
 
-    ImageData img;
     img.width = width;
     img.height = height;
-    img.data = std::vector<uint8_t>(data, data + (width * height * 4));
+    resizeBuffer(img.data, static_cast<size_t>(width) * height * 4);
+    std::memcpy(img.data.data(), data, img.data.size());
 
     stbi_image_free(data);
     return img;
 }
 
+ImageData ImageLoader::loadFromMemory(const uint8_t* bytes, size_t size, const std::string& name) {
+    ImageData img;
+    decodeInto(bytes, size, name, img);
+    return img;
+}
+
+void ImageLoader::decodeInto(const uint8_t* bytes, size_t size, const std::string& name, ImageData& image) {
+    if (decoder() == ImageDecoder::Native) {
+        try {
+            if (decodePNGNative(bytes, size, image)) {
+                return;
+            }
+            if (hasExtension(name, ".tga") && decodeTGANative(bytes, size, image)) {
+                return;
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throw std::runtime_error("Failed to load image: " + name + " - " + e.what());
+        }
+    }
+    decodeWithStb(bytes, size, name, image);
+}
+
+bool ImageLoader::readDimensions(const std::string& filename, uint32_t& width, uint32_t& height) {
+    int w, h, channels;
+    if (!stbi_info(filename.c_str(), &w, &h, &channels)) {
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
+
+ImageData ImageLoader::loadThumbnail(const std::string& filename, uint32_t maxSize) {
+    return downscale(load(filename), maxSize);
+}
+
+ImageData ImageLoader::downscale(const ImageData& image, uint32_t maxSize) {
+    uint32_t longest = std::max(image.width, image.height);
+    if (maxSize == 0 || longest <= maxSize) {
+        return image;
+    }
+
+    ImageData out;
+    out.width = std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(image.width) * maxSize / longest));
+    out.height = std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(image.height) * maxSize / longest));
+    out.data.resize(static_cast<size_t>(out.width) * out.height * 4);
+
+    // Each output pixel averages the source rectangle it covers
+    for (uint32_t y = 0; y < out.height; y++) {
+        uint32_t sy0 = static_cast<uint32_t>(uint64_t(y) * image.height / out.height);
+        uint32_t sy1 = std::max(sy0 + 1, static_cast<uint32_t>(uint64_t(y + 1) * image.height / out.height));
+
+        for (uint32_t x = 0; x < out.width; x++) {
+            uint32_t sx0 = static_cast<uint32_t>(uint64_t(x) * image.width / out.width);
+            uint32_t sx1 = std::max(sx0 + 1, static_cast<uint32_t>(uint64_t(x + 1) * image.width / out.width));
+
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (uint32_t sy = sy0; sy < sy1; sy++) {
+                const uint8_t* row = image.data.data() + (static_cast<size_t>(sy) * image.width + sx0) * 4;
+                for (uint32_t sx = sx0; sx < sx1; sx++, row += 4) {
+                    sum[0] += row[0];
+                    sum[1] += row[1];
+                    sum[2] += row[2];
+                    sum[3] += row[3];
+                }
+            }
+
+            uint32_t count = (sy1 - sy0) * (sx1 - sx0);
+            uint8_t* dst = out.data.data() + (static_cast<size_t>(y) * out.width + x) * 4;
+            for (int c = 0; c < 4; c++) {
+                dst[c] = static_cast<uint8_t>(sum[c] / count);
+            }
+        }
+    }
+
+    return out;
+}
+
 void ImageLoader::savePNG(const std::string& filename, const ImageData& image) {
     int result = stbi_write_png(
         filename.c_str(),
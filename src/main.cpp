@@ -1,11 +1,26 @@
 #include "paa.h"
+#include "paa_verify.h"
+#include "paa_diff.h"
+#include "batch_converter.h"
+#include "batch_report.h"
 #include "image_loader.h"
+#include "metrics.h"
+#include "sharding.h"
+#include "thread_pool.h"
+#include "utils.h"
 
 #include <iostream>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <fstream>
 #include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
 
 namespace fs = std::filesystem;
 
@@ -13,33 +28,440 @@ void printUsage(const char* programName) {
     std::cout << "Arma 3 PAA Converter - Native C++ Edition\n";
     std::cout << "==========================================\n\n";
     std::cout << "Usage:\n";
-    std::cout << "  " << programName << " <input> <output> [options]\n\n";
+    std::cout << "  " << programName << " <input> <output> [options]\n";
+    std::cout << "  " << programName << " verify <file|dir>... [--decode] [--json] [--threads N]\n";
+    std::cout << "  " << programName << " diff <a.paa|dir> <b.paa|dir> [--json] [--threads N] [--min-psnr dB]\n";
+    std::cout << "         [--bytes-only] [--regions N]\n";
+    std::cout << "  " << programName << " merge-report <out.json> <shard.json>...\n";
+    std::cout << "  " << programName << " repack <in.paa> [out.paa] [--drop-mips K] [--lzo on|off]\n";
+    std::cout << "         [--set-tagg SIG=hex] [--remove-tagg SIG] [--atomic]\n\n";
     std::cout << "Options:\n";
-    std::cout << "  --format <DXT1|DXT5>    Compression format (default: auto-detect)\n";
-    std::cout << "  --batch <pattern>       Batch convert files matching pattern\n";
-    std::cout << "  --output-dir <dir>      Output directory for batch mode\n\n";
+    std::cout << "  --format <DXTn>         DXT1, DXT5, DXT3 or premultiplied DXT2/DXT4 (default: auto-detect)\n";
+    std::cout << "  --quality <tier>        Encoder effort: fast, balanced (default), best\n";
+    std::cout << "  --auto                  Pick the cheapest format/effort meeting --min-psnr\n";
+    std::cout << "  --min-psnr <dB>         Quality target for --auto (default: 40)\n";
+    std::cout << "  --min-ssim <0..1>       Additional SSIM target for --auto (default: off)\n";
+    std::cout << "  --max-size <N>          Cap the top mip's longer side at N pixels\n";
+    std::cout << "  --drop-mips <K>         Drop the K largest mip levels\n";
+    std::cout << "  --mip-filter <filter>   Mip filter: box (default), kaiser, lanczos\n";
+    std::cout << "  --srgb-mips             Filter kaiser/lanczos mips in sRGB instead of linear light\n";
+    std::cout << "  --alpha-coverage <a>    Keep each mip's alpha-test coverage at cutoff a (e.g. 0.5)\n";
+    std::cout << "  --batch <pattern>       Batch convert files matching a glob (*, ?, [..], **)\n";
+    std::cout << "  --files0-from <file|->  Batch convert a NUL-separated path list (e.g. find -print0)\n";
+    std::cout << "  --threads <N>           Worker threads for batch mode (default: all cores)\n";
+    std::cout << "  --pin                   Pin batch workers to cores, spread over NUMA nodes\n";
+    std::cout << "  --no-buffer-pool        Don't recycle image and block buffers across batch jobs\n";
+    std::cout << "  --decoder <backend>     Source decoding: native (libpng + TGA reader, default), stb\n";
+    std::cout << "  --io <backend>          Batch file I/O: blocking (default), threads, uring, auto\n";
+    std::cout << "  --atomic                Write each PAA under a temporary name and rename it into place\n";
+    std::cout << "  --output-dir <dir>      Output directory for batch mode\n";
+    std::cout << "  --incremental           Only convert sources changed since the last run\n";
+    std::cout << "  --shard <i/N>           Convert only shard i of N (weighted by pixel count)\n";
+    std::cout << "  --report <file.json>    Write per-file results as JSON (batch mode)\n";
+    std::cout << "  --watch <dir>           Reconvert PNG/TGA files below dir as they are saved (Linux)\n";
+    std::cout << "  --debounce <ms>         Quiet time after a save before --watch converts (default: 250)\n";
+    std::cout << "  --stats                 Print allocations per stage, thread and file, and peak memory\n";
+    std::cout << "  --stats-json <file>     Same, written as JSON\n";
+    std::cout << "  --metrics <file.prom>   Keep Prometheus metrics in a file while batch/watch runs\n";
+    std::cout << "  --metrics-interval <s>  Seconds between metrics file updates (default: 10)\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << programName << " texture.png texture.paa\n";
     std::cout << "  " << programName << " texture.png texture.paa --format DXT5\n";
     std::cout << "  " << programName << " --batch \"*.png\" --output-dir ./paa/\n";
-}
-
-std::string getOutputFilename(const std::string& input, const std::string& outputDir = "") {
-    fs::path inputPath(input);
-    std::string outputName = inputPath.stem().string() + ".paa";
-
-    if (!outputDir.empty()) {
-        return (fs::path(outputDir) / outputName).string();
-    }
-    return outputName;
+    std::cout << "  " << programName << " --batch \"textures/**/*_co.tga\" --output-dir ./paa/\n";
+    std::cout << "  find . -name '*.png' -print0 | " << programName << " --files0-from - --output-dir ./paa/\n";
+    std::cout << "  " << programName << " --batch \"*.png\" --auto --min-psnr 42\n";
+    std::cout << "  " << programName << " --watch textures/ --output-dir ./paa/\n";
 }
 
 arma3::PAAFormat parseFormat(const std::string& formatStr) {
     if (formatStr == "DXT1") return arma3::PAAFormat::DXT1;
+    if (formatStr == "DXT2") return arma3::PAAFormat::DXT2;
+    if (formatStr == "DXT3") return arma3::PAAFormat::DXT3;
+    if (formatStr == "DXT4") return arma3::PAAFormat::DXT4;
     if (formatStr == "DXT5") return arma3::PAAFormat::DXT5;
     return arma3::PAAFormat::UNKNOWN;
 }
 
+arma3::EncoderTier parseTier(const std::string& tierStr) {
+    if (tierStr == "fast") return arma3::EncoderTier::Fast;
+    if (tierStr == "best") return arma3::EncoderTier::Best;
+    if (tierStr == "balanced") return arma3::EncoderTier::Balanced;
+    throw std::runtime_error("Unknown quality tier: " + tierStr);
+}
+
+bool hasExtension(const fs::path& path, const char* ext) {
+    std::string actual = path.extension().string();
+    std::transform(actual.begin(), actual.end(), actual.begin(), ::tolower);
+    return actual == ext;
+}
+
+// verify <file|dir>... : structural check of existing PAAs, in parallel
+int runVerify(int argc, char** argv) {
+    std::vector<std::string> roots;
+    arma3::VerifyOptions verifyOptions;
+    bool json = false;
+    size_t threads = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--decode") verifyOptions.decodeLevels = true;
+        else if (arg == "--json") json = true;
+        else if (arg == "--threads" && i + 1 < argc) threads = std::stoul(argv[++i]);
+        else roots.push_back(arg);
+    }
+
+    if (roots.empty()) {
+        std::cerr << "Error: verify needs at least one file or directory\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::mutex outputMutex;
+    std::atomic<size_t> fileCount{0};
+    std::atomic<size_t> failCount{0};
+    std::atomic<uint64_t> byteCount{0};
+
+    arma3::ThreadPool pool(threads);
+    auto submit = [&](const std::string& path) {
+        pool.submit([&, path]() {
+            arma3::VerifyReport report = arma3::verifyPAAFile(path, verifyOptions);
+            fileCount++;
+            byteCount += report.fileSize;
+            if (!report.ok) failCount++;
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (json) {
+                std::cout << arma3::verifyReportToJSON(report) << "\n";
+            } else if (!report.ok) {
+                std::cout << "✗ " << path << "\n";
+                for (const auto& error : report.errors) {
+                    std::cout << "    " << error << "\n";
+                }
+            }
+        });
+    };
+
+    for (const auto& root : roots) {
+        std::error_code ec;
+        if (fs::is_directory(root, ec)) {
+            for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+                 it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                if (ec) break;
+                if (it->is_regular_file(ec) && hasExtension(it->path(), ".paa")) {
+                    submit(it->path().string());
+                }
+            }
+        } else {
+            submit(root);
+        }
+    }
+
+    pool.wait();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!json) {
+        std::cout << "\nVerified " << fileCount << " files (" << byteCount / (1024 * 1024) << " MB) in "
+                  << seconds << "s: " << (fileCount - failCount) << " ok, " << failCount << " failed\n";
+    }
+
+    return failCount == 0 ? 0 : 2;
+}
+
+void printDiff(const arma3::PAADiff& diff, bool decoded, bool verbose) {
+    if (!diff.error.empty()) {
+        std::cout << "✗ " << diff.pathA << " / " << diff.pathB << ": " << diff.error << "\n";
+        return;
+    }
+    if (diff.identical) {
+        if (verbose) std::cout << "= " << diff.pathA << ": identical\n";
+        return;
+    }
+
+    std::cout << (diff.significant ? "≠ " : "~ ") << diff.pathA << " / " << diff.pathB << "\n";
+    for (const auto& change : diff.headerChanges) {
+        std::cout << "    " << change << "\n";
+    }
+    for (const auto& mip : diff.mips) {
+        if (mip.levelA >= 0 && mip.levelB >= 0 && !mip.payloadChanged && !verbose) continue;
+
+        std::cout << "    " << mip.width << "x" << mip.height << ": ";
+        if (mip.levelB < 0) {
+            std::cout << "only in a (level " << mip.levelA << ")\n";
+            continue;
+        }
+        if (mip.levelA < 0) {
+            std::cout << "only in b (level " << mip.levelB << ")\n";
+            continue;
+        }
+        if (!mip.payloadChanged) {
+            std::cout << "unchanged\n";
+            continue;
+        }
+        if (mip.bytesOnly) {
+            std::cout << "payload differs (compared as bytes)\n";
+            continue;
+        }
+        std::cout << mip.changedBlocks << "/" << mip.blocks << " blocks changed";
+        if (mip.visibleBlocks > 0) {
+            char psnr[32];
+            std::snprintf(psnr, sizeof(psnr), "%.1f", mip.psnr);
+            std::cout << ", " << mip.visibleBlocks << " visible, max delta " << mip.maxDelta
+                      << ", PSNR " << psnr << " dB";
+        } else if (decoded) {
+            std::cout << ", decoding to the same pixels";
+        }
+        std::cout << "\n";
+        for (const auto& region : mip.regions) {
+            std::cout << "        " << region.width << "x" << region.height << " at "
+                      << region.x << "," << region.y << " (" << region.blocks << " blocks)\n";
+        }
+    }
+}
+
+// diff <a> <b> : block-level comparison of two PAAs or two trees of them.
+// Exit code 0 = nothing significant, 1 = significant changes, 2 = errors
+int runDiff(int argc, char** argv) {
+    std::vector<std::string> paths;
+    arma3::DiffOptions diffOptions;
+    bool json = false;
+    size_t threads = 0;
+
+    // Usage errors exit 2 like unreadable files: 1 means "significant changes"
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--json") json = true;
+            else if (arg == "--bytes-only") diffOptions.decodeBlocks = false;
+            else if (arg == "--threads" && i + 1 < argc) threads = std::stoul(argv[++i]);
+            else if (arg == "--min-psnr" && i + 1 < argc) diffOptions.minPSNR = std::stod(argv[++i]);
+            else if (arg == "--regions" && i + 1 < argc) diffOptions.maxRegions = std::stoul(argv[++i]);
+            else paths.push_back(arg);
+        }
+        catch (const std::exception&) {
+            std::cerr << "Error: invalid value for " << arg << ": " << argv[i] << "\n";
+            return 2;
+        }
+    }
+
+    if (paths.size() != 2) {
+        std::cerr << "Error: diff needs exactly two files or two directories\n";
+        return 2;
+    }
+
+    std::error_code ec;
+    const bool treeA = fs::is_directory(paths[0], ec);
+    const bool treeB = fs::is_directory(paths[1], ec);
+    if (treeA != treeB) {
+        std::cerr << "Error: diff compares two files or two directories, not one of each\n";
+        return 2;
+    }
+
+    if (!treeA) {
+        arma3::PAADiff diff = arma3::diffPAAFiles(paths[0], paths[1], diffOptions);
+        if (json) {
+            std::cout << arma3::paaDiffToJSON(diff) << "\n";
+        } else {
+            printDiff(diff, diffOptions.decodeBlocks, true);
+        }
+        if (!diff.error.empty()) return 2;
+        return diff.significant ? 1 : 0;
+    }
+
+    // Pair files by path relative to each root
+    auto listTree = [](const fs::path& root) {
+        std::vector<std::string> files;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+             it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) break;
+            if (it->is_regular_file(ec) && hasExtension(it->path(), ".paa")) {
+                files.push_back(it->path().lexically_relative(root).generic_string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    };
+    std::vector<std::string> filesA = listTree(paths[0]);
+    std::vector<std::string> filesB = listTree(paths[1]);
+
+    std::vector<std::string> common;
+    std::vector<std::string> onlyA;
+    std::vector<std::string> onlyB;
+    std::set_intersection(filesA.begin(), filesA.end(), filesB.begin(), filesB.end(), std::back_inserter(common));
+    std::set_difference(filesA.begin(), filesA.end(), filesB.begin(), filesB.end(), std::back_inserter(onlyA));
+    std::set_difference(filesB.begin(), filesB.end(), filesA.begin(), filesA.end(), std::back_inserter(onlyB));
+
+    auto start = std::chrono::steady_clock::now();
+    std::mutex outputMutex;
+    std::atomic<size_t> identicalCount{0};
+    std::atomic<size_t> changedCount{0};
+    std::atomic<size_t> significantCount{0};
+    std::atomic<size_t> errorCount{0};
+
+    arma3::ThreadPool pool(threads);
+    for (const auto& relative : common) {
+        pool.submit([&, relative]() {
+            arma3::PAADiff diff = arma3::diffPAAFiles((fs::path(paths[0]) / relative).string(),
+                                                      (fs::path(paths[1]) / relative).string(), diffOptions);
+            if (!diff.error.empty()) errorCount++;
+            else if (diff.identical) identicalCount++;
+            else if (diff.significant) significantCount++;
+            else changedCount++;
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (json) {
+                std::cout << arma3::paaDiffToJSON(diff) << "\n";
+            } else {
+                printDiff(diff, diffOptions.decodeBlocks, false);
+            }
+        });
+    }
+    pool.wait();
+
+    for (const auto& relative : onlyA) {
+        if (json) std::cout << "{\"a\":\"" << arma3::utils::jsonEscape(relative) << "\",\"only\":\"a\"}\n";
+        else std::cout << "- " << relative << "\n";
+    }
+    for (const auto& relative : onlyB) {
+        if (json) std::cout << "{\"b\":\"" << arma3::utils::jsonEscape(relative) << "\",\"only\":\"b\"}\n";
+        else std::cout << "+ " << relative << "\n";
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!json) {
+        std::cout << "\nCompared " << common.size() << " files in " << seconds << "s: "
+                  << identicalCount << " identical, " << changedCount << " within tolerance, "
+                  << significantCount << " changed, " << onlyA.size() << " only in a, "
+                  << onlyB.size() << " only in b, " << errorCount << " errors\n";
+    }
+
+    if (errorCount > 0) return 2;
+    return significantCount == 0 && onlyA.empty() && onlyB.empty() ? 0 : 1;
+}
+
+// merge-report <out.json> <shard.json>... : combine per-shard batch reports
+int runMergeReport(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "Error: merge-report needs an output file and at least one shard report\n";
+        return 1;
+    }
+
+    std::vector<arma3::BatchReport> reports;
+    for (int i = 3; i < argc; i++) {
+        reports.push_back(arma3::BatchReport::read(argv[i]));
+    }
+
+    arma3::MergedReport merged = arma3::mergeReports(reports);
+
+    std::ofstream ofs(argv[2]);
+    if (!ofs) {
+        throw std::runtime_error(std::string("Failed to write ") + argv[2]);
+    }
+    ofs << merged.toJSON();
+
+    const auto& totals = merged.totals;
+    std::cout << "Merged " << reports.size() << " shard reports: " << totals.files << " files, "
+              << totals.succeeded << " successful, " << totals.failed << " failed, "
+              << totals.skipped << " up to date\n";
+    std::cout << "Slowest shard " << totals.wallSeconds << "s, imbalance " << merged.imbalance << "x, "
+              << totals.bytesIn / (1024 * 1024) << " MB in, " << totals.bytesOut / (1024 * 1024) << " MB out\n";
+    for (uint32_t missing : merged.missingShards) {
+        std::cout << "Warning: no report for shard " << missing << "\n";
+    }
+
+    return merged.totals.failed == 0 && merged.missingShards.empty() ? 0 : 2;
+}
+
+// "GGATCGVA" or just "CGVA"
+std::string parseTaggSignature(const std::string& name) {
+    std::string signature = name.size() == 4 ? "GGAT" + name : name;
+    if (signature.size() != 8 || signature.compare(0, 4, "GGAT") != 0) {
+        throw std::runtime_error("Invalid TAGG signature: " + name);
+    }
+    return signature;
+}
+
+// SIG=hexbytes, e.g. GALF=01ffffff
+arma3::Tagg parseTagg(const std::string& spec) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos || (spec.size() - eq - 1) % 2 != 0) {
+        throw std::runtime_error("Invalid TAGG (expected SIG=hexbytes): " + spec);
+    }
+
+    arma3::Tagg tagg;
+    tagg.signature = parseTaggSignature(spec.substr(0, eq));
+    for (size_t i = eq + 1; i < spec.size(); i += 2) {
+        tagg.data.push_back(static_cast<uint8_t>(std::stoul(spec.substr(i, 2), nullptr, 16)));
+    }
+    tagg.dataLength = static_cast<uint32_t>(tagg.data.size());
+    return tagg;
+}
+
+// repack <in.paa> [out.paa] : container-level rewrite without touching DXT data
+int runRepack(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    arma3::RepackOptions repackOptions;
+    bool atomic = false;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--drop-mips" && i + 1 < argc) {
+            repackOptions.dropMips = std::stoul(argv[++i]);
+        }
+        else if (arg == "--lzo" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "on") repackOptions.lzo = arma3::LZOMode::Compress;
+            else if (mode == "off") repackOptions.lzo = arma3::LZOMode::Decompress;
+            else if (mode == "keep") repackOptions.lzo = arma3::LZOMode::Keep;
+            else throw std::runtime_error("Unknown --lzo mode: " + mode);
+        }
+        else if (arg == "--set-tagg" && i + 1 < argc) {
+            repackOptions.setTaggs.push_back(parseTagg(argv[++i]));
+        }
+        else if (arg == "--remove-tagg" && i + 1 < argc) {
+            repackOptions.removeTaggs.push_back(parseTaggSignature(argv[++i]));
+        }
+        else if (arg == "--atomic") {
+            atomic = true;
+        }
+        else if (input.empty()) {
+            input = arg;
+        }
+        else if (output.empty()) {
+            output = arg;
+        }
+    }
+
+    if (input.empty()) {
+        std::cerr << "Error: repack needs an input file\n";
+        return 1;
+    }
+    if (output.empty()) {
+        // In place: never leave a truncated original behind
+        output = input;
+        atomic = true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    arma3::PAA paa(input);
+    paa.readPAA(false);
+    size_t mipsBefore = paa.getMipMaps().size();
+    paa.repack(repackOptions);
+    paa.writePAA(output, arma3::PAAFormat::UNKNOWN, atomic);
+
+    std::cout << input << ": " << arma3::formatName(paa.getFormat()) << ", "
+              << mipsBefore << " → " << paa.getMipMaps().size() << " mipmaps\n";
+    uint64_t bytes = fs::file_size(output);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "✓ Repacked → " << output << " (" << bytes / 1024 << " KB in "
+              << static_cast<int>(seconds * 1000) << "ms)\n";
+    return 0;
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
         printUsage(argv[0]);
@@ -47,11 +469,23 @@ int main(int argc, char** argv) {
     }
 
     try {
+        if (std::string(argv[1]) == "verify") {
+            return runVerify(argc, argv);
+        }
+        if (std::string(argv[1]) == "diff") {
+            return runDiff(argc, argv);
+        }
+        if (std::string(argv[1]) == "merge-report") {
+            return runMergeReport(argc, argv);
+        }
+        if (std::string(argv[1]) == "repack") {
+            return runRepack(argc, argv);
+        }
+
         std::string input;
         std::string output;
-        std::string batchPattern;
-        std::string outputDir;
-        arma3::PAAFormat format = arma3::PAAFormat::UNKNOWN;
+        arma3::ConvertOptions options;
+        arma3::BatchOptions batchOptions;
         bool batchMode = false;
 
         // Parse arguments
@@ -59,14 +493,91 @@ int main(int argc, char** argv) {
             std::string arg = argv[i];
 
             if (arg == "--format" && i + 1 < argc) {
-                format = parseFormat(argv[++i]);
+                options.format = parseFormat(argv[++i]);
+            }
+            else if (arg == "--quality" && i + 1 < argc) {
+                options.tier = parseTier(argv[++i]);
+            }
+            else if (arg == "--auto") {
+                options.autoMode = true;
+            }
+            else if (arg == "--min-psnr" && i + 1 < argc) {
+                options.autoSettings.minPSNR = std::stod(argv[++i]);
+            }
+            else if (arg == "--min-ssim" && i + 1 < argc) {
+                options.autoSettings.minSSIM = std::stod(argv[++i]);
+            }
+            else if (arg == "--max-size" && i + 1 < argc) {
+                options.mips.maxSize = std::stoul(argv[++i]);
+            }
+            else if (arg == "--drop-mips" && i + 1 < argc) {
+                options.mips.dropMips = std::stoul(argv[++i]);
+            }
+            else if (arg == "--mip-filter" && i + 1 < argc) {
+                options.mips.filter = arma3::parseMipFilter(argv[++i]);
+            }
+            else if (arg == "--srgb-mips") {
+                options.mips.linearLight = false;
+            }
+            else if (arg == "--alpha-coverage" && i + 1 < argc) {
+                options.mips.alphaCoverage = std::stof(argv[++i]);
             }
             else if (arg == "--batch" && i + 1 < argc) {
-                batchPattern = argv[++i];
+                batchOptions.pattern = argv[++i];
                 batchMode = true;
             }
+            else if (arg == "--files0-from" && i + 1 < argc) {
+                batchOptions.filesFrom = argv[++i];
+                batchMode = true;
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                batchOptions.threads = std::stoul(argv[++i]);
+            }
+            else if (arg == "--decoder" && i + 1 < argc) {
+                arma3::ImageLoader::setDecoder(arma3::parseImageDecoder(argv[++i]));
+            }
+            else if (arg == "--pin") {
+                batchOptions.pinWorkers = true;
+            }
+            else if (arg == "--no-buffer-pool") {
+                batchOptions.bufferPool = false;
+            }
+            else if (arg == "--atomic") {
+                options.atomicWrite = true;
+            }
+            else if (arg == "--io" && i + 1 < argc) {
+                batchOptions.io = arma3::parseIOBackend(argv[++i]);
+            }
             else if (arg == "--output-dir" && i + 1 < argc) {
-                outputDir = argv[++i];
+                batchOptions.outputDir = argv[++i];
+            }
+            else if (arg == "--incremental") {
+                batchOptions.incremental = true;
+            }
+            else if (arg == "--shard" && i + 1 < argc) {
+                arma3::parseShardSpec(argv[++i], batchOptions.shardIndex, batchOptions.shardCount);
+            }
+            else if (arg == "--report" && i + 1 < argc) {
+                batchOptions.reportPath = argv[++i];
+            }
+            else if (arg == "--watch" && i + 1 < argc) {
+                batchOptions.watchDir = argv[++i];
+            }
+            else if (arg == "--debounce" && i + 1 < argc) {
+                batchOptions.debounceMs = std::stoul(argv[++i]);
+            }
+            else if (arg == "--stats") {
+                batchOptions.stats = true;
+            }
+            else if (arg == "--stats-json" && i + 1 < argc) {
+                batchOptions.stats = true;
+                batchOptions.statsPath = argv[++i];
+            }
+            else if (arg == "--metrics" && i + 1 < argc) {
+                batchOptions.metricsPath = argv[++i];
+            }
+            else if (arg == "--metrics-interval" && i + 1 < argc) {
+                batchOptions.metricsIntervalMs = static_cast<uint32_t>(arma3::parseMetricsInterval(argv[++i]).count());
             }
             else if (arg == "--help" || arg == "-h") {
                 printUsage(argv[0]);
@@ -80,55 +591,16 @@ int main(int argc, char** argv) {
             }
         }
 
-        if (batchMode) {
-            // Batch conversion
-            std::cout << "Batch mode: " << batchPattern << "\n";
-
-            if (!outputDir.empty() && !fs::exists(outputDir)) {
-                fs::create_directories(outputDir);
-            }
-
-            std::vector<std::string> files;
-            for (const auto& entry : fs::directory_iterator(".")) {
-                if (entry.is_regular_file()) {
-                    std::string filename = entry.path().string();
-                    if (filename.find(".png") != std::string::npos ||
-                        filename.find(".tga") != std::string::npos) {
-                        files.push_back(filename);
-                    }
-                }
-            }
-
-            std::cout << "Found " << files.size() << " files\n";
-
-            int successCount = 0;
-            int failCount = 0;
-
-            for (const auto& file : files) {
-                try {
-                    auto start = std::chrono::high_resolution_clock::now();
-
-                    arma3::PAA paa;
-                    paa.loadImage(file);
-
-                    std::string outFile = getOutputFilename(file, outputDir);
-                    paa.writePAA(outFile, format);
-
-                    auto end = std::chrono::high_resolution_clock::now();
-                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-                    std::cout << "✓ " << file << " → " << outFile
-                              << " (" << duration.count() << "ms)\n";
-                    successCount++;
-                }
-                catch (const std::exception& e) {
-                    std::cerr << "✗ " << file << " - Error: " << e.what() << "\n";
-                    failCount++;
+        if (batchMode || !batchOptions.watchDir.empty()) {
+            arma3::BatchConverter converter(batchOptions, options);
+            // --batch with --watch: bring everything up to date, then follow changes
+            if (batchMode) {
+                int status = converter.run();
+                if (batchOptions.watchDir.empty()) {
+                    return status;
                 }
             }
-
-            std::cout << "\nBatch complete: " << successCount << " successful, "
-                      << failCount << " failed\n";
+            return converter.watch();
         }
         else {
             // Single file conversion
@@ -140,16 +612,39 @@ int main(int argc, char** argv) {
 
             std::cout << "Converting: " << input << " → " << output << "\n";
 
+            if (batchOptions.stats) {
+                arma3::resetPeakResidentSize();
+                arma3::enableAllocationTracking();
+            }
+
             auto start = std::chrono::high_resolution_clock::now();
 
-            arma3::PAA paa;
-            paa.loadImage(input);
-            paa.writePAA(output, format);
+            arma3::NamedFileMemory file;
+            file.path = input;
+            arma3::ConvertResult result;
+            {
+                arma3::FileMemoryRecorder memoryRecorder(file.memory);
+                result = arma3::convertFile(input, output, options);
+            }
+            const std::string& note = result.note;
 
             auto end = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
+            if (!note.empty()) {
+                std::cout << "  " << note << "\n";
+            }
             std::cout << "✓ Conversion complete in " << duration.count() << "ms\n";
+
+            if (batchOptions.stats) {
+                arma3::disableAllocationTracking();
+                file.pixels = static_cast<uint64_t>(result.width) * result.height;
+                arma3::AllocationSnapshot snapshot = arma3::snapshotAllocations();
+                if (!batchOptions.statsPath.empty()) {
+                    std::ofstream(batchOptions.statsPath) << arma3::allocationStatsToJSON(snapshot, {file}) << "\n";
+                }
+                arma3::printAllocationStats(std::cout, snapshot, {file});
+            }
         }
 
         return 0;
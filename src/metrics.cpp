@@ -0,0 +1,347 @@
+#include "metrics.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace arma3 {
+
+const double LatencyHistogram::bounds[LatencyHistogram::BoundCount] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0
+};
+
+namespace {
+
+constexpr size_t StageCount = static_cast<size_t>(Stage::Count);
+constexpr size_t CauseCount = static_cast<size_t>(FailureCause::Count);
+constexpr size_t BucketCount = LatencyHistogram::BoundCount + 1;
+
+// Only ever written by the thread owning the shard, so a relaxed load and
+// store replace a locked read-modify-write
+struct RelaxedCounter {
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct ShardHistogram {
+    RelaxedCounter buckets[BucketCount];
+    RelaxedCounter sumMicros;
+
+    void observe(double seconds) {
+        size_t bucket = std::lower_bound(LatencyHistogram::bounds,
+                                         LatencyHistogram::bounds + LatencyHistogram::BoundCount,
+                                         seconds) - LatencyHistogram::bounds;
+        buckets[bucket].add(1);
+        sumMicros.add(static_cast<uint64_t>(seconds * 1e6 + 0.5));
+    }
+
+    void addTo(LatencyHistogram& histogram) const {
+        for (size_t i = 0; i < BucketCount; i++) {
+            uint64_t n = buckets[i].get();
+            histogram.buckets[i] += n;
+            histogram.count += n;
+        }
+        histogram.sum += sumMicros.get() / 1e6;
+    }
+};
+
+struct alignas(64) Shard {
+    RelaxedCounter converted;
+    RelaxedCounter upToDate;
+    RelaxedCounter failed[CauseCount];
+    RelaxedCounter pixels;
+    RelaxedCounter bytesWritten;
+    ShardHistogram stages[StageCount];
+    ShardHistogram files;
+    RelaxedCounter busyMicros;
+    std::atomic<int64_t> busySince{0};  // steady clock, microseconds; 0 while idle
+};
+
+thread_local Shard* threadShard = nullptr;
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Never freed: a worker's counts outlive it, and the totals never go down
+std::vector<Shard*>& registry() {
+    static auto* shards = new std::vector<Shard*>();
+    return *shards;
+}
+
+// The registry lock is taken once per thread, on its first record, and
+// by snapshots; never on the recording path after that
+Shard& currentShard() {
+    if (!threadShard) {
+        Shard* shard = new Shard();
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(shard);
+        threadShard = shard;
+    }
+    return *threadShard;
+}
+
+int64_t steadyMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void writeHistogram(std::ostringstream& out, const char* name, const std::string& labels,
+                    const LatencyHistogram& histogram) {
+    const std::string prefix = labels.empty() ? "{" : "{" + labels + ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < LatencyHistogram::BoundCount; i++) {
+        cumulative += histogram.buckets[i];
+        out << name << "_bucket" << prefix << "le=\"" << LatencyHistogram::bounds[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += histogram.buckets[LatencyHistogram::BoundCount];
+    out << name << "_bucket" << prefix << "le=\"+Inf\"} " << cumulative << "\n";
+    const std::string plain = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << plain << " " << histogram.sum << "\n";
+    out << name << "_count" << plain << " " << histogram.count << "\n";
+}
+
+void writeHeader(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+} // namespace
+
+const char* failureCauseName(FailureCause cause) {
+    switch (cause) {
+        case FailureCause::Read: return "read";
+        case FailureCause::Decode: return "decode";
+        case FailureCause::Encode: return "encode";
+        case FailureCause::Write: return "write";
+        case FailureCause::Cancelled: return "cancelled";
+        default: return "other";
+    }
+}
+
+FailureCause failureCauseFor(Stage stage) {
+    switch (stage) {
+        case Stage::Read: return FailureCause::Read;
+        case Stage::Decode: return FailureCause::Decode;
+        case Stage::Mips:
+        case Stage::Encode: return FailureCause::Encode;
+        case Stage::Write: return FailureCause::Write;
+        default: return FailureCause::Other;
+    }
+}
+
+void recordConversion(const ConversionSample& sample) {
+    Shard& shard = currentShard();
+    shard.converted.add(1);
+    shard.pixels.add(sample.pixels);
+    shard.bytesWritten.add(sample.bytesWritten);
+    shard.files.observe(sample.seconds);
+    for (size_t i = 0; i < StageCount; i++) {
+        if (sample.stages.ms[i] > 0.0) {
+            shard.stages[i].observe(sample.stages.ms[i] / 1000.0);
+        }
+    }
+}
+
+void recordFailure(FailureCause cause) {
+    currentShard().failed[static_cast<size_t>(cause)].add(1);
+}
+
+void recordUpToDate() {
+    currentShard().upToDate.add(1);
+}
+
+WorkerBusyScope::WorkerBusyScope() {
+    currentShard().busySince.store(steadyMicros(), std::memory_order_relaxed);
+}
+
+WorkerBusyScope::~WorkerBusyScope() {
+    Shard& shard = currentShard();
+    int64_t since = shard.busySince.load(std::memory_order_relaxed);
+    // Publish the finished interval before closing the open one: a
+    // concurrent snapshot may count it twice for an instant but never drops it
+    shard.busyMicros.add(static_cast<uint64_t>(std::max<int64_t>(0, steadyMicros() - since)));
+    shard.busySince.store(0, std::memory_order_release);
+}
+
+MetricsSnapshot snapshotMetrics() {
+    MetricsSnapshot snapshot;
+    const int64_t now = steadyMicros();
+    uint64_t busyMicros = 0;
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (const Shard* shard : registry()) {
+        snapshot.converted += shard->converted.get();
+        snapshot.upToDate += shard->upToDate.get();
+        for (size_t i = 0; i < CauseCount; i++) {
+            snapshot.failed[i] += shard->failed[i].get();
+        }
+        snapshot.pixels += shard->pixels.get();
+        snapshot.bytesWritten += shard->bytesWritten.get();
+        for (size_t i = 0; i < StageCount; i++) {
+            shard->stages[i].addTo(snapshot.stages[i]);
+        }
+        shard->files.addTo(snapshot.files);
+
+        int64_t since = shard->busySince.load(std::memory_order_acquire);
+        busyMicros += shard->busyMicros.get();
+        if (since != 0) {
+            snapshot.busyWorkers++;
+            busyMicros += static_cast<uint64_t>(std::max<int64_t>(0, now - since));
+        }
+    }
+    snapshot.busySeconds = busyMicros / 1e6;
+    return snapshot;
+}
+
+std::string metricsToPrometheus(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out.precision(15);
+
+    writeHeader(out, "arma3paa_files_converted_total", "counter", "Textures converted and written.");
+    out << "arma3paa_files_converted_total " << snapshot.converted << "\n";
+
+    writeHeader(out, "arma3paa_files_up_to_date_total", "counter", "Textures skipped by --incremental.");
+    out << "arma3paa_files_up_to_date_total " << snapshot.upToDate << "\n";
+
+    writeHeader(out, "arma3paa_files_failed_total", "counter", "Failed conversions by the stage they failed in.");
+    for (size_t i = 0; i < CauseCount; i++) {
+        out << "arma3paa_files_failed_total{cause=\"" << failureCauseName(static_cast<FailureCause>(i))
+            << "\"} " << snapshot.failed[i] << "\n";
+    }
+
+    writeHeader(out, "arma3paa_encoded_megapixels_total", "counter", "Top-level megapixels encoded.");
+    out << "arma3paa_encoded_megapixels_total " << snapshot.pixels / 1e6 << "\n";
+
+    writeHeader(out, "arma3paa_written_bytes_total", "counter", "PAA bytes written.");
+    out << "arma3paa_written_bytes_total " << snapshot.bytesWritten << "\n";
+
+    writeHeader(out, "arma3paa_stage_duration_seconds", "histogram", "Time per pipeline stage of one conversion.");
+    for (size_t i = 0; i < StageCount; i++) {
+        writeHistogram(out, "arma3paa_stage_duration_seconds",
+                       std::string("stage=\"") + stageName(static_cast<Stage>(i)) + "\"", snapshot.stages[i]);
+    }
+
+    writeHeader(out, "arma3paa_file_duration_seconds", "histogram", "Time per successful conversion.");
+    writeHistogram(out, "arma3paa_file_duration_seconds", "", snapshot.files);
+
+    writeHeader(out, "arma3paa_queue_depth", "gauge", "Conversions waiting for a worker.");
+    out << "arma3paa_queue_depth " << snapshot.gauges.queueDepth << "\n";
+
+    writeHeader(out, "arma3paa_workers", "gauge", "Conversion worker threads.");
+    out << "arma3paa_workers " << snapshot.gauges.workers << "\n";
+
+    writeHeader(out, "arma3paa_workers_busy", "gauge", "Workers currently converting.");
+    out << "arma3paa_workers_busy " << snapshot.busyWorkers << "\n";
+
+    writeHeader(out, "arma3paa_worker_busy_seconds_total", "counter", "Worker time spent converting.");
+    out << "arma3paa_worker_busy_seconds_total " << snapshot.busySeconds << "\n";
+
+    writeHeader(out, "arma3paa_worker_utilization", "gauge", "Busy share of all workers since the previous export.");
+    out << "arma3paa_worker_utilization " << snapshot.utilization << "\n";
+
+    return out.str();
+}
+
+std::chrono::milliseconds parseMetricsInterval(const std::string& seconds) {
+    double value = 0.0;
+    try {
+        value = std::stod(seconds);
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("Invalid --metrics-interval: " + seconds);
+    }
+    // Also rejects NaN
+    if (!(value >= 0.1 && value <= 86400.0)) {
+        throw std::runtime_error("--metrics-interval must be between 0.1 and 86400 seconds: " + seconds);
+    }
+    return std::chrono::milliseconds(static_cast<int64_t>(value * 1000.0 + 0.5));
+}
+
+MetricsExporter::MetricsExporter(std::string path, std::chrono::milliseconds interval,
+                                 std::function<MetricsGauges()> gauges)
+    : path(std::move(path)),
+      interval(interval),
+      gauges(std::move(gauges)),
+      lastBusySeconds(snapshotMetrics().busySeconds),
+      lastExport(std::chrono::steady_clock::now()) {
+    writeNow();
+    thread = std::thread([this]() { loop(); });
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    writeNow();
+}
+
+void MetricsExporter::writeNow() {
+    MetricsSnapshot snapshot = snapshotMetrics();
+    if (gauges) {
+        snapshot.gauges = gauges();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastExport).count();
+        if (elapsed > 0.0 && snapshot.gauges.workers > 0) {
+            snapshot.utilization = std::min(1.0, (snapshot.busySeconds - lastBusySeconds) /
+                                                 (elapsed * snapshot.gauges.workers));
+        }
+        if (elapsed > 0.0) {
+            lastBusySeconds = snapshot.busySeconds;
+            lastExport = now;
+        }
+    }
+
+    std::string temporary = utils::temporaryPathFor(path);
+    bool written = false;
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out << metricsToPrometheus(snapshot);
+        out.close();
+        written = !out.fail();
+    }
+    if (!written) {
+        // Otherwise a full or read-only directory gains a stray file per interval
+        std::remove(temporary.c_str());
+        std::cerr << "Warning: failed to write metrics to " << temporary << "\n";
+        return;
+    }
+    try {
+        utils::replaceFile(temporary, path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << "\n";
+    }
+}
+
+void MetricsExporter::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (wake.wait_for(lock, interval, [this]() { return stopping; })) {
+            break;
+        }
+        lock.unlock();
+        writeNow();
+        lock.lock();
+    }
+}
+
+} // namespace arma3
\ No newline at end of file
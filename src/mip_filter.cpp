@@ -0,0 +1,564 @@
+#include "mip_filter.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARMA3_HAVE_SSE2 1
+#endif
+
+namespace arma3 {
+
+namespace {
+
+void downsampleRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, uint32_t begin, uint32_t end) {
+    for (uint32_t x = begin; x < end; x++) {
+        const uint8_t* a = row0 + x * 8;
+        const uint8_t* b = row1 + x * 8;
+        for (int c = 0; c < 4; c++) {
+            dst[x * 4 + c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4]) / 4);
+        }
+    }
+}
+
+// Filtered downsampling. A 2:1 decimation puts every output pixel at the
+// same phase, so one 12-tap kernel (source offsets -5..+6 around 2x) serves
+// the whole image; only the clamped edges differ.
+const int Taps = 12;
+const int TapOffset = 5;
+
+double sinc(double x) {
+    if (std::abs(x) < 1e-9) {
+        return 1.0;
+    }
+    const double pi = 3.14159265358979323846;
+    return std::sin(pi * x) / (pi * x);
+}
+
+// Zeroth-order modified Bessel function of the first kind
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+struct Kernel {
+    float weights[Taps];
+};
+
+Kernel makeKernel(MipFilter filter) {
+    Kernel kernel;
+    double total = 0.0;
+    double values[Taps];
+
+    for (int k = 0; k < Taps; k++) {
+        // Distance of tap k from the output centre, in output pixels
+        double t = (k - TapOffset - 0.5) / 2.0;
+        double value;
+        if (filter == MipFilter::Lanczos) {
+            value = std::abs(t) < 3.0 ? sinc(t) * sinc(t / 3.0) : 0.0;
+        } else {
+            const double width = 3.0;
+            const double alpha = 4.0;
+            double r = t / width;
+            value = std::abs(r) < 1.0 ? sinc(t) * besselI0(alpha * std::sqrt(1.0 - r * r)) / besselI0(alpha) : 0.0;
+        }
+        values[k] = value;
+        total += value;
+    }
+
+    for (int k = 0; k < Taps; k++) {
+        kernel.weights[k] = static_cast<float>(values[k] / total);
+    }
+    return kernel;
+}
+
+const Kernel& kernelFor(MipFilter filter) {
+    static const Kernel kaiser = makeKernel(MipFilter::Kaiser);
+    static const Kernel lanczos = makeKernel(MipFilter::Lanczos);
+    return filter == MipFilter::Lanczos ? lanczos : kaiser;
+}
+
+// sRGB <-> linear through tables: 256 entries in, 16K entries out so that
+// dark values (where the curve is steepest) still round correctly
+const int LinearSteps = 16384;
+
+struct ColorTables {
+    float toLinear[256];
+    float toUnit[256];
+    uint8_t toSRGB[LinearSteps + 1];
+
+    ColorTables() {
+        for (int i = 0; i < 256; i++) {
+            double c = i / 255.0;
+            toLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+            toUnit[i] = static_cast<float>(c);
+        }
+        for (int i = 0; i <= LinearSteps; i++) {
+            double l = static_cast<double>(i) / LinearSteps;
+            double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            toSRGB[i] = static_cast<uint8_t>(std::min(255.0, std::max(0.0, c * 255.0 + 0.5)));
+        }
+    }
+};
+
+const ColorTables& colorTables() {
+    static const ColorTables tables;
+    return tables;
+}
+
+// Helper threads for large levels. The caller always works through the
+// bands itself, so a busy (or single-threaded) pool never stalls a level
+// and batch workers calling in concurrently cannot deadlock. Pinned batch
+// workers filter alone: helpers could run on another NUMA node, and the
+// other workers already keep every core busy.
+ThreadPool& filterPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+template<typename Fn>
+void parallelBands(uint32_t count, uint32_t bandSize, Fn&& fn) {
+    uint32_t bands = (count + bandSize - 1) / bandSize;
+    if (bands <= 1 || currentThreadPinned()) {
+        fn(0u, count);
+        return;
+    }
+
+    struct State {
+        std::atomic<uint32_t> next{0};
+        uint32_t done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::function<void(uint32_t)> run;
+    };
+    auto state = std::make_shared<State>();
+    state->run = [&fn, count, bandSize](uint32_t band) {
+        uint32_t begin = band * bandSize;
+        fn(begin, std::min(count, begin + bandSize));
+    };
+
+    // Returns once no unclaimed band is left; `run` is only ever invoked
+    // while the caller is still waiting for that band
+    auto work = [state, bands]() {
+        for (;;) {
+            uint32_t band = state->next.fetch_add(1);
+            if (band >= bands) return;
+            state->run(band);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->done == bands) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(bands - 1, filterPool().size());
+    for (size_t i = 0; i < helpers; i++) {
+        filterPool().submit(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done == bands; });
+}
+
+// One source row converted to float RGBA and filtered horizontally. The
+// row is padded with copies of its edge pixels, so every output pixel reads
+// taps 2x .. 2x+11 of the padded row without clamping.
+void filterRow(const uint8_t* src, uint32_t srcWidth, float* out, uint32_t outWidth,
+               const Kernel& kernel, const float* rgbTable, std::vector<float>& scratch) {
+    const float* unit = colorTables().toUnit;
+    scratch.resize((static_cast<size_t>(srcWidth) + Taps) * 4);
+    float* padded = scratch.data() + TapOffset * 4;
+
+    for (uint32_t x = 0; x < srcWidth; x++) {
+        padded[x * 4 + 0] = rgbTable[src[x * 4 + 0]];
+        padded[x * 4 + 1] = rgbTable[src[x * 4 + 1]];
+        padded[x * 4 + 2] = rgbTable[src[x * 4 + 2]];
+        padded[x * 4 + 3] = unit[src[x * 4 + 3]];
+    }
+    for (int i = 1; i <= TapOffset; i++) {
+        std::copy(padded, padded + 4, padded - i * 4);
+    }
+    for (int i = 0; i < Taps - TapOffset; i++) {
+        std::copy(padded + (srcWidth - 1) * 4, padded + srcWidth * 4, padded + (srcWidth + i) * 4);
+    }
+
+    const float* base = scratch.data();
+    uint32_t x = 0;
+
+#ifdef ARMA3_HAVE_SSE2
+    __m128 weights[Taps / 2];
+    for (int k = 0; k < Taps / 2; k++) {
+        weights[k] = _mm_set1_ps(kernel.weights[k]);
+    }
+
+    // Four output pixels per step: independent accumulators keep the
+    // multiply-adds from waiting on each other. The kernel is symmetric,
+    // so mirrored taps are added before the multiply
+    for (; x + 4 <= outWidth; x += 4) {
+        const float* p = base + x * 8;
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        for (int k = 0; k < Taps / 2; k++) {
+            const float* a = p + k * 4;
+            const float* b = p + (Taps - 1 - k) * 4;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 8), _mm_loadu_ps(b + 8))));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 16), _mm_loadu_ps(b + 16))));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 24), _mm_loadu_ps(b + 24))));
+        }
+        _mm_storeu_ps(out + x * 4, acc0);
+        _mm_storeu_ps(out + x * 4 + 4, acc1);
+        _mm_storeu_ps(out + x * 4 + 8, acc2);
+        _mm_storeu_ps(out + x * 4 + 12, acc3);
+    }
+#endif
+
+    for (; x < outWidth; x++) {
+        const float* p = base + x * 8;
+        float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < Taps; k++) {
+            for (int c = 0; c < 4; c++) {
+                acc[c] += kernel.weights[k] * p[k * 4 + c];
+            }
+        }
+        std::copy(acc, acc + 4, out + x * 4);
+    }
+}
+
+// Vertical pass for one output row: taps[k] are the horizontally filtered
+// rows (already clamped at the image edges)
+void filterColumn(const float* const* taps, float* out, uint32_t width, const Kernel& kernel) {
+    uint32_t x = 0;
+
+#ifdef ARMA3_HAVE_SSE2
+    __m128 weights[Taps / 2];
+    for (int k = 0; k < Taps / 2; k++) {
+        weights[k] = _mm_set1_ps(kernel.weights[k]);
+    }
+
+    for (; x + 4 <= width; x += 4) {
+        size_t i = static_cast<size_t>(x) * 4;
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        for (int k = 0; k < Taps / 2; k++) {
+            const float* a = taps[k] + i;
+            const float* b = taps[Taps - 1 - k] + i;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4))));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 8), _mm_loadu_ps(b + 8))));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(weights[k], _mm_add_ps(_mm_loadu_ps(a + 12), _mm_loadu_ps(b + 12))));
+        }
+        _mm_storeu_ps(out + i, acc0);
+        _mm_storeu_ps(out + i + 4, acc1);
+        _mm_storeu_ps(out + i + 8, acc2);
+        _mm_storeu_ps(out + i + 12, acc3);
+    }
+#endif
+
+    for (; x < width; x++) {
+        size_t i = static_cast<size_t>(x) * 4;
+        float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < Taps; k++) {
+            for (int c = 0; c < 4; c++) {
+                acc[c] += kernel.weights[k] * taps[k][i + c];
+            }
+        }
+        std::copy(acc, acc + 4, out + i);
+    }
+}
+
+// Float RGBA (0..1) back to bytes through the output tables
+void quantizeRow(const float* src, uint8_t* dst, uint32_t width, const uint8_t* rgbTable, const uint8_t* alphaTable) {
+    uint32_t x = 0;
+
+#ifdef ARMA3_HAVE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(static_cast<float>(LinearSteps));
+    const __m128 half = _mm_set1_ps(0.5f);
+    alignas(16) int32_t index[4];
+
+    for (; x < width; x++) {
+        __m128 v = _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(src + x * 4)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(index),
+                        _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+        dst[x * 4 + 0] = rgbTable[index[0]];
+        dst[x * 4 + 1] = rgbTable[index[1]];
+        dst[x * 4 + 2] = rgbTable[index[2]];
+        dst[x * 4 + 3] = alphaTable[index[3]];
+    }
+#endif
+
+    for (; x < width; x++) {
+        for (int c = 0; c < 4; c++) {
+            float value = std::min(1.0f, std::max(0.0f, src[x * 4 + c]));
+            int index = static_cast<int>(value * LinearSteps + 0.5f);
+            dst[x * 4 + c] = c == 3 ? alphaTable[index] : rgbTable[index];
+        }
+    }
+}
+
+} // namespace
+
+const char* mipFilterName(MipFilter filter) {
+    switch (filter) {
+        case MipFilter::Kaiser: return "kaiser";
+        case MipFilter::Lanczos: return "lanczos";
+        default: return "box";
+    }
+}
+
+MipFilter parseMipFilter(const std::string& name) {
+    if (name == "box") return MipFilter::Box;
+    if (name == "kaiser") return MipFilter::Kaiser;
+    if (name == "lanczos") return MipFilter::Lanczos;
+    throw std::runtime_error("Unknown mip filter: " + name + " (box, kaiser, lanczos)");
+}
+
+ImageData downsampleBox(const ImageData& image) {
+    if (image.width < 2 || image.height < 2) {
+        throw std::runtime_error("Image too small to downsample");
+    }
+
+    ImageData out;
+    out.width = image.width / 2;
+    out.height = image.height / 2;
+    out.data = acquireBuffer(static_cast<size_t>(out.width) * out.height * 4);
+
+    const size_t srcStride = static_cast<size_t>(image.width) * 4;
+
+    for (uint32_t y = 0; y < out.height; y++) {
+        const uint8_t* row0 = image.data.data() + (2 * y) * srcStride;
+        const uint8_t* row1 = row0 + srcStride;
+        uint8_t* dst = out.data.data() + static_cast<size_t>(y) * out.width * 4;
+        uint32_t x = 0;
+
+#ifdef ARMA3_HAVE_SSE2
+        // 8 source pixels per row -> 4 output pixels. Even and odd pixels
+        // are split with a 32-bit shuffle, widened to 16 bits and summed
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= out.width; x += 4) {
+            __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8)));
+            __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16)));
+            __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8)));
+            __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16)));
+
+            __m128i aEven = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i aOdd = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i bEven = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i bOdd = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            __m128i lo = _mm_add_epi16(
+                _mm_add_epi16(_mm_unpacklo_epi8(aEven, zero), _mm_unpacklo_epi8(aOdd, zero)),
+                _mm_add_epi16(_mm_unpacklo_epi8(bEven, zero), _mm_unpacklo_epi8(bOdd, zero)));
+            __m128i hi = _mm_add_epi16(
+                _mm_add_epi16(_mm_unpackhi_epi8(aEven, zero), _mm_unpackhi_epi8(aOdd, zero)),
+                _mm_add_epi16(_mm_unpackhi_epi8(bEven, zero), _mm_unpackhi_epi8(bOdd, zero)));
+
+            __m128i packed = _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), packed);
+        }
+#endif
+
+        downsampleRowScalar(row0, row1, dst, x, out.width);
+    }
+
+    return out;
+}
+
+ImageData downsampleFiltered(const ImageData& image, MipFilter filter, bool linearLight) {
+    if (filter == MipFilter::Box) {
+        return downsampleBox(image);
+    }
+    if (image.width < 2 || image.height < 2) {
+        throw std::runtime_error("Image too small to downsample");
+    }
+
+    const Kernel& kernel = kernelFor(filter);
+    const ColorTables& tables = colorTables();
+    const float* rgbIn = linearLight ? tables.toLinear : tables.toUnit;
+
+    // Linear output goes back through the sRGB table; otherwise a plain
+    // 0..1 -> 0..255 ramp at the same resolution
+    static const std::vector<uint8_t> unitOut = []() {
+        std::vector<uint8_t> table(LinearSteps + 1);
+        for (int i = 0; i <= LinearSteps; i++) {
+            table[i] = static_cast<uint8_t>(static_cast<double>(i) * 255.0 / LinearSteps + 0.5);
+        }
+        return table;
+    }();
+    const uint8_t* rgbOut = linearLight ? tables.toSRGB : unitOut.data();
+
+    ImageData out;
+    out.width = image.width / 2;
+    out.height = image.height / 2;
+    out.data = acquireBuffer(static_cast<size_t>(out.width) * out.height * 4);
+
+    const size_t srcStride = static_cast<size_t>(image.width) * 4;
+    const size_t rowFloats = static_cast<size_t>(out.width) * 4;
+    const int lastRow = static_cast<int>(image.height) - 1;
+
+    // Bands of output rows; each band filters the source rows it needs
+    // horizontally into its own buffer, then runs the vertical pass
+    uint32_t bandSize = std::max<uint32_t>(16, (out.height + 63) / 64);
+    if (static_cast<uint64_t>(out.width) * out.height < 128 * 128) {
+        bandSize = out.height;
+    }
+
+    parallelBands(out.height, bandSize, [&](uint32_t y0, uint32_t y1) {
+        int firstRow = std::max(0, static_cast<int>(2 * y0) - TapOffset);
+        int lastNeeded = std::min(lastRow, static_cast<int>(2 * (y1 - 1)) - TapOffset + Taps - 1);
+
+        // Kept per thread: workers and filter helpers reuse them for every band
+        thread_local std::vector<float> rows, scratch, column;
+        rows.resize(static_cast<size_t>(lastNeeded - firstRow + 1) * rowFloats);
+        column.resize(rowFloats);
+        for (int sy = firstRow; sy <= lastNeeded; sy++) {
+            filterRow(image.data.data() + sy * srcStride, image.width,
+                      rows.data() + (sy - firstRow) * rowFloats, out.width, kernel, rgbIn, scratch);
+        }
+
+        for (uint32_t y = y0; y < y1; y++) {
+            const float* taps[Taps];
+            for (int k = 0; k < Taps; k++) {
+                int sy = std::min(std::max(static_cast<int>(2 * y) - TapOffset + k, 0), lastRow);
+                taps[k] = rows.data() + (sy - firstRow) * rowFloats;
+            }
+
+            filterColumn(taps, column.data(), out.width, kernel);
+
+            quantizeRow(column.data(), out.data.data() + static_cast<size_t>(y) * out.width * 4,
+                        out.width, rgbOut, unitOut.data());
+        }
+    });
+
+    return out;
+}
+
+float alphaCoverage(const ImageData& image, float cutoff) {
+    size_t pixels = static_cast<size_t>(image.width) * image.height;
+    if (pixels == 0) {
+        return 0.0f;
+    }
+
+    float threshold = cutoff * 255.0f;
+    size_t covered = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        if (image.data[i * 4 + 3] > threshold) covered++;
+    }
+    return static_cast<float>(covered) / pixels;
+}
+
+void scaleAlphaToCoverage(ImageData& image, float cutoff, float coverage) {
+    size_t pixels = static_cast<size_t>(image.width) * image.height;
+    if (pixels == 0 || cutoff <= 0.0f || cutoff >= 1.0f) {
+        return;
+    }
+
+    // Coverage as a function of the scale only depends on the alpha histogram
+    size_t histogram[256] = {};
+    for (size_t i = 0; i < pixels; i++) {
+        histogram[image.data[i * 4 + 3]]++;
+    }
+    auto coverageAt = [&](float scale) {
+        float threshold = cutoff * 255.0f;
+        size_t covered = 0;
+        for (int a = 0; a < 256; a++) {
+            if (std::min(255.0f, a * scale) > threshold) covered += histogram[a];
+        }
+        return static_cast<float>(covered) / pixels;
+    };
+
+    float low = 0.0f;
+    float high = 4.0f;
+    float best = 1.0f;
+    float bestError = std::abs(coverageAt(1.0f) - coverage);
+    for (int i = 0; i < 20; i++) {
+        float mid = (low + high) / 2.0f;
+        float value = coverageAt(mid);
+        float error = std::abs(value - coverage);
+        if (error < bestError) {
+            best = mid;
+            bestError = error;
+        }
+        if (value < coverage) low = mid; else high = mid;
+    }
+
+    if (best == 1.0f) {
+        return;
+    }
+    uint8_t table[256];
+    for (int a = 0; a < 256; a++) {
+        table[a] = static_cast<uint8_t>(std::min(255.0f, a * best + 0.5f));
+    }
+    for (size_t i = 0; i < pixels; i++) {
+        image.data[i * 4 + 3] = table[image.data[i * 4 + 3]];
+    }
+}
+
+std::vector<ImageData> buildMipChain(ImageData top, const MipChainOptions& options) {
+    const bool keepCoverage = options.alphaCoverage > 0.0f && options.alphaCoverage < 1.0f;
+    const float coverage = keepCoverage ? alphaCoverage(top, options.alphaCoverage) : 0.0f;
+
+    std::vector<ImageData> chain;
+    ImageData current = std::move(top);
+
+    for (uint32_t level = 0;; level++) {
+        bool last = std::min(current.width, current.height) <= options.minSize;
+
+        // The next level is built from the unscaled one first, so this one
+        // can then be stored (and its alpha adjusted) without a copy
+        ImageData next;
+        if (!last) {
+            next = downsampleFiltered(current, options.filter, options.linearLight);
+        }
+
+        if (level >= options.skipLevels || last) {
+            if (keepCoverage && level > 0) {
+                scaleAlphaToCoverage(current, options.alphaCoverage, coverage);
+            }
+            chain.push_back(std::move(current));
+        } else {
+            recycleBuffer(std::move(current.data));
+        }
+        if (last) {
+            break;
+        }
+
+        current = std::move(next);
+    }
+
+    return chain;
+}
+
+uint32_t levelsAboveSize(uint32_t width, uint32_t height, uint32_t maxSize) {
+    uint32_t levels = 0;
+    if (maxSize == 0) {
+        return 0;
+    }
+    while (std::max(width, height) > maxSize && std::min(width, height) > 1) {
+        width /= 2;
+        height /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -1,18 +1,162 @@
 #include "paa.h"
+#include "paa_codec.h"
+#include "buffer_pool.h"
 #include "utils.h"
 #include "image_loader.h"
+#include "mip_filter.h"
+#include "stage_timer.h"
+#include "alloc_stats.h"
 
-#include <squish.h>
 //#include <lzo/lzo1x.h>  // LZO disabled for now
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 namespace arma3 {
 
 using namespace utils;
 
+const char* formatName(PAAFormat format) {
+    switch (format) {
+        case PAAFormat::DXT1: return "DXT1";
+        case PAAFormat::DXT2: return "DXT2";
+        case PAAFormat::DXT3: return "DXT3";
+        case PAAFormat::DXT4: return "DXT4";
+        case PAAFormat::DXT5: return "DXT5";
+        case PAAFormat::RGBA4444: return "RGBA4444";
+        case PAAFormat::RGBA5551: return "RGBA5551";
+        case PAAFormat::RGBA8888: return "RGBA8888";
+        case PAAFormat::GRAY_ALPHA: return "GRAY_ALPHA";
+        default: return "UNKNOWN";
+    }
+}
+
+PAAFormat formatFromMagic(uint16_t magic) {
+    switch (magic) {
+        case 0xFF01: return PAAFormat::DXT1;
+        case 0xFF02: return PAAFormat::DXT2;
+        case 0xFF03: return PAAFormat::DXT3;
+        case 0xFF04: return PAAFormat::DXT4;
+        case 0xFF05: return PAAFormat::DXT5;
+        case 0x4444: return PAAFormat::RGBA4444;
+        case 0x1555: return PAAFormat::RGBA5551;
+        case 0x8888: return PAAFormat::RGBA8888;
+        case 0x8080: return PAAFormat::GRAY_ALPHA;
+        default: return PAAFormat::UNKNOWN;
+    }
+}
+
+namespace {
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le24(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+} // namespace
+
+PAAHeaderView parsePAAHeaders(const uint8_t* data, size_t size) {
+    PAAHeaderView view;
+    size_t pos = 0;
+
+    auto require = [&](size_t count, const char* what) {
+        if (count > size - pos) {
+            throw std::runtime_error(std::string("Truncated PAA: ") + what + " runs past end of file");
+        }
+    };
+
+    require(2, "magic number");
+    view.format = formatFromMagic(le16(data));
+    if (view.format == PAAFormat::UNKNOWN) {
+        throw std::runtime_error("Invalid PAA magic number: " + std::to_string(le16(data)));
+    }
+    pos = 2;
+
+    // TAGGs
+    // Anything not starting with "GGAT" is the palette length
+    while (size - pos >= 4 && std::memcmp(data + pos, "GGAT", 4) == 0) {
+        require(12, "TAGG header");
+        std::string signature(reinterpret_cast<const char*>(data + pos), 8);
+        uint32_t length = le32(data + pos + 8);
+        pos += 12;
+        require(length, "TAGG data");
+
+        if (signature == "GGATGALF") {
+            view.hasAlpha = true;
+        } else if (signature == "GGATCGVA" && length >= 4) {
+            std::memcpy(view.averageColor, data + pos, 4);
+        } else if (signature == "GGATCXAM" && length >= 4) {
+            std::memcpy(view.maxColor, data + pos, 4);
+        }
+        view.taggs.push_back({signature, data + pos, length});
+        pos += length;
+    }
+
+    // Palette
+    require(2, "palette length");
+    view.paletteLength = le16(data + pos);
+    pos += 2;
+    require(view.paletteLength, "palette");
+    pos += view.paletteLength;
+
+    // Mip headers; payloads are only pointed at
+    for (;;) {
+        require(2, "mipmap header");
+        if (le16(data + pos) == 0) {
+            break;
+        }
+        require(7, "mipmap header");
+        PAAHeaderView::Level level;
+        uint16_t width = le16(data + pos);
+        level.width = width & 0x7FFF;
+        level.lzoCompressed = (width & 0x8000) != 0;
+        level.height = le16(data + pos + 2);
+        level.dataLength = le24(data + pos + 4);
+        pos += 7;
+        require(level.dataLength, "mipmap data");
+        level.data = data + pos;
+        pos += level.dataLength;
+        view.mips.push_back(level);
+    }
+
+    return view;
+}
+
+size_t dxtBlockBytes(PAAFormat format) {
+    if (!hasCodec(format)) {
+        return 0;
+    }
+    return dispatchCodec(format, [](auto codec) { return decltype(codec)::bytesPerBlock; });
+}
+
+bool isPremultipliedFormat(PAAFormat format) {
+    return hasCodec(format) && dispatchCodec(format, [](auto codec) { return decltype(codec)::premultiplied; });
+}
+
+void decodeDXTBlocks(PAAFormat format, const uint8_t* blocks, size_t size,
+                     uint32_t width, uint32_t height, uint8_t* rgba) {
+    if (!hasCodec(format)) {
+        throw std::runtime_error(std::string("Unsupported PAA format for decoding: ") + formatName(format));
+    }
+
+    dispatchCodec(format, [&](auto codec) {
+        using Codec = decltype(codec);
+        if (size < levelBytes<Codec>(width, height)) {
+            throw std::runtime_error("Corrupt PAA: mipmap payload shorter than its dimensions need");
+        }
+        decodeLevel<Codec>(blocks, width, height, rgba);
+    });
+}
+
 PAA::PAA() : format(PAAFormat::DXT5), magicNumber(0xFF05) {}
 
 PAA::PAA(const std::string& filename) {
@@ -25,7 +169,13 @@ PAA::PAA(const std::vector<uint8_t>& data) {
     );
 }
 
-void PAA::readPAA() {
+PAA::~PAA() {
+    for (auto& mip : mipMaps) {
+        recycleBuffer(std::move(mip.data));
+    }
+}
+
+void PAA::readPAA(bool decodeBlocks) {
     if (!inputStream) {
         throw std::runtime_error("No input stream available");
     }
@@ -35,25 +185,37 @@ void PAA::readPAA() {
     // Read magic number
     magicNumber = readBytes<uint16_t>(stream);
 
-    switch (magicNumber) {
-        case 0xFF01: format = PAAFormat::DXT1; break;
-        case 0xFF02: format = PAAFormat::DXT2; break;
-        case 0xFF03: format = PAAFormat::DXT3; break;
-        case 0xFF04: format = PAAFormat::DXT4; break;
-        case 0xFF05: format = PAAFormat::DXT5; break;
-        case 0x4444: format = PAAFormat::RGBA4444; break;
-        case 0x1555: format = PAAFormat::RGBA5551; break;
-        case 0x8888: format = PAAFormat::RGBA8888; break;
-        case 0x8080: format = PAAFormat::GRAY_ALPHA; break;
-        default:
-            throw std::runtime_error("Invalid PAA magic number: " + std::to_string(magicNumber));
-    }
-
-    // Read tags
-    while (stream.peek() != 0) {
+    format = formatFromMagic(magicNumber);
+    if (!stream || format == PAAFormat::UNKNOWN) {
+        throw std::runtime_error("Invalid PAA magic number: " + std::to_string(magicNumber));
+    }
+
+    // Lengths below come straight from the file; never trust them beyond EOF
+    const uint64_t streamSize = streamLength(stream);
+    auto requireBytes = [&](uint64_t count, const char* what) {
+        std::streamoff pos = stream.tellg();
+        if (!stream || pos < 0 || static_cast<uint64_t>(pos) + count > streamSize) {
+            throw std::runtime_error(std::string("Truncated PAA: ") + what + " runs past end of file");
+        }
+    };
+
+    // Read tags; anything not starting with "GGAT" is the palette length
+    for (;;) {
+        std::streamoff tagStart = stream.tellg();
+        char prefix[4] = {};
+        stream.read(prefix, sizeof(prefix));
+        bool isTagg = stream.gcount() == 4 && std::memcmp(prefix, "GGAT", 4) == 0;
+        stream.clear();
+        stream.seekg(tagStart);
+        if (!isTagg) {
+            break;
+        }
+
+        requireBytes(12, "TAGG header");
         Tagg tagg;
         tagg.signature = readString(stream, 8);
         tagg.dataLength = readBytes<uint32_t>(stream);
+        requireBytes(tagg.dataLength, "TAGG data");
         tagg.data = readBytes<uint8_t>(stream, tagg.dataLength);
         taggs.push_back(tagg);
 
@@ -63,49 +225,110 @@ void PAA::readPAA() {
     }
 
     // Read palette
+    requireBytes(2, "palette length");
     palette.dataLength = readBytes<uint16_t>(stream);
     if (palette.dataLength > 0) {
+        requireBytes(palette.dataLength, "palette");
         palette.data = readBytes<uint8_t>(stream, palette.dataLength);
     }
 
     // Read mipmaps
-    while (peekBytes<uint16_t>(stream) != 0) {
+    for (;;) {
+        requireBytes(2, "mipmap header");
+        if (peekBytes<uint16_t>(stream) == 0) {
+            break;
+        }
+
+        requireBytes(7, "mipmap header");
         MipMap mipmap;
         mipmap.width = readBytes<uint16_t>(stream);
         mipmap.height = readBytes<uint16_t>(stream);
         mipmap.dataLength = readBytesAsArmaUShort(stream);
+        requireBytes(mipmap.dataLength, "mipmap data");
         mipmap.data = readBytes<uint8_t>(stream, mipmap.dataLength);
 
         // Check for LZO compression flag
         if ((mipmap.width & 0x8000) != 0) {
             mipmap.width &= 0x7FFF;
             mipmap.lzoCompressed = true;
-            decompressLZO(mipmap);
+            if (decodeBlocks) {
+                decompressLZO(mipmap);
+            }
         }
 
-        // Decompress DXT
-        if (format == PAAFormat::DXT1) {
-            decompressDXT1(mipmap);
-        } else if (format == PAAFormat::DXT5) {
-            decompressDXT5(mipmap);
+        mipMaps.push_back(std::move(mipmap));
+    }
+
+    // One dispatch for the whole chain
+    if (decodeBlocks && hasCodec(format)) {
+        dispatchCodec(format, [this](auto codec) {
+            for (auto& mipmap : mipMaps) {
+                decompressLevel<decltype(codec)>(mipmap);
+            }
+        });
+    }
+
+    mipsDecoded = decodeBlocks;
+}
+
+ImageData PAA::decodeMipMap(size_t level) const {
+    if (level >= mipMaps.size()) {
+        throw std::out_of_range("Mipmap level out of range");
+    }
+
+    MipMap mipmap = mipMaps[level];
+    if (!mipsDecoded) {
+        if (mipmap.lzoCompressed) {
+            decompressLZO(mipmap);
+        }
+        if (!hasCodec(format)) {
+            throw std::runtime_error(std::string("Unsupported PAA format for decoding: ") + formatName(format));
         }
+        dispatchCodec(format, [&](auto codec) { decompressLevel<decltype(codec)>(mipmap); });
+    }
 
-        mipMaps.push_back(mipmap);
+    ImageData img;
+    img.width = mipmap.width;
+    img.height = mipmap.height;
+    img.data = std::move(mipmap.data);
+    return img;
+}
+
+size_t PAA::findMipForSize(uint32_t minSize) const {
+    if (mipMaps.empty()) {
+        throw std::runtime_error("PAA has no mipmaps");
+    }
+
+    // Mips are stored largest first
+    size_t best = 0;
+    for (size_t i = 0; i < mipMaps.size(); i++) {
+        if (std::max(mipMaps[i].width, mipMaps[i].height) < minSize) {
+            break;
+        }
+        best = i;
     }
+    return best;
 }
 
 void PAA::loadImage(const std::string& filename) {
-    ImageData img = ImageLoader::load(filename);
+    ImageData image;
+    {
+        StageScope stageScope(Stage::Decode);
+        image = ImageLoader::load(filename);
+    }
+    loadImage(std::move(image));
+}
 
+void PAA::loadImage(ImageData img) {
     mipMaps.clear();
 
     MipMap mipmap;
     mipmap.width = img.width;
     mipmap.height = img.height;
-    mipmap.data = img.data;
     mipmap.dataLength = img.data.size();
+    mipmap.data = std::move(img.data);
 
-    mipMaps.push_back(mipmap);
+    mipMaps.push_back(std::move(mipmap));
     calculateMipmapsAndTaggs();
 }
 
@@ -114,50 +337,39 @@ void PAA::calculateMipmapsAndTaggs() {
         throw std::runtime_error("No mipmaps to calculate from");
     }
 
-    uint32_t curWidth = mipMaps[0].width;
-    uint32_t curHeight = mipMaps[0].height;
+    StageScope stageScope(Stage::Mips);
 
-    // Generate mipmaps
-    std::vector<MipMap> generatedMips;
-    generatedMips.push_back(mipMaps[0]);
+    // Levels above the size limits are downsampled but never kept
+    uint32_t skip = std::max(mipSettings.dropMips,
+                             levelsAboveSize(mipMaps[0].width, mipMaps[0].height, mipSettings.maxSize));
 
-    while (std::min(curWidth, curHeight) > 4) {
-        uint32_t newWidth = curWidth / 2;
-        uint32_t newHeight = curHeight / 2;
+    MipChainOptions chainOptions;
+    chainOptions.filter = mipSettings.filter;
+    chainOptions.linearLight = mipSettings.linearLight;
+    chainOptions.alphaCoverage = mipSettings.alphaCoverage;
+    chainOptions.skipLevels = skip;
 
-        MipMap mipmap;
-        mipmap.width = newWidth;
-        mipmap.height = newHeight;
-        mipmap.data.resize(newWidth * newHeight * 4);
-
-        // Simple bilinear downsampling
-        const auto& srcData = generatedMips.back().data;
-        for (uint32_t y = 0; y < newHeight; y++) {
-            for (uint32_t x = 0; x < newWidth; x++) {
-                uint32_t sx = x * 2;
-                uint32_t sy = y * 2;
-
-                for (int c = 0; c < 4; c++) {
-                    uint32_t p1 = srcData[(sy * curWidth + sx) * 4 + c];
-                    uint32_t p2 = srcData[(sy * curWidth + sx + 1) * 4 + c];
-                    uint32_t p3 = srcData[((sy + 1) * curWidth + sx) * 4 + c];
-                    uint32_t p4 = srcData[((sy + 1) * curWidth + sx + 1) * 4 + c];
-
-                    mipmap.data[(y * newWidth + x) * 4 + c] = (p1 + p2 + p3 + p4) / 4;
-                }
-            }
-        }
-
-        mipmap.dataLength = mipmap.data.size();
-        generatedMips.push_back(mipmap);
+    ImageData top;
+    top.width = mipMaps[0].width;
+    top.height = mipMaps[0].height;
+    top.data = std::move(mipMaps[0].data);
 
-        curWidth = newWidth;
-        curHeight = newHeight;
+    // Generate mipmaps
+    MemoryStageScope memoryScope(MemoryStage::Mips);
+    std::vector<MipMap> generatedMips;
+    for (auto& level : buildMipChain(std::move(top), chainOptions)) {
+        MipMap mipmap;
+        mipmap.width = level.width;
+        mipmap.height = level.height;
+        mipmap.dataLength = level.data.size();
+        mipmap.data = std::move(level.data);
+        generatedMips.push_back(std::move(mipmap));
     }
 
-    mipMaps = generatedMips;
+    mipMaps = std::move(generatedMips);
 
     // Calculate average color
+    averageRed = averageGreen = averageBlue = averageAlpha = 0;
     for (size_t i = 0; i < mipMaps[0].data.size(); i += 4) {
         averageRed += mipMaps[0].data[i];
         averageGreen += mipMaps[0].data[i + 1];
@@ -172,6 +384,7 @@ void PAA::calculateMipmapsAndTaggs() {
     averageAlpha /= pixelCount;
 
     // Create tags
+    MemoryStageScope taggScope(MemoryStage::Taggs);
     taggs.clear();
 
     // Average color tag
@@ -204,7 +417,16 @@ void PAA::calculateMipmapsAndTaggs() {
     }
 }
 
-void PAA::writePAA(const std::string& filename, PAAFormat targetFormat) {
+std::vector<MipMap> PAA::encodeMipMaps(PAAFormat targetFormat) {
+    if (!mipsDecoded) {
+        // Payloads from readPAA(false) or repack are written as stored
+        if (targetFormat != PAAFormat::UNKNOWN && targetFormat != format) {
+            throw std::runtime_error(std::string("Cannot write undecoded ") + formatName(format) +
+                                     " mipmaps as " + formatName(targetFormat));
+        }
+        return mipMaps;
+    }
+
     if (mipMaps.size() <= 1) {
         calculateMipmapsAndTaggs();
     }
@@ -212,26 +434,36 @@ void PAA::writePAA(const std::string& filename, PAAFormat targetFormat) {
     // Determine format
     if (targetFormat == PAAFormat::UNKNOWN) {
         format = hasTransparency ? PAAFormat::DXT5 : PAAFormat::DXT1;
-    } else {
+    } else if (hasCodec(targetFormat)) {
         format = targetFormat;
+    } else {
+        throw std::runtime_error(std::string("Unsupported PAA format for encoding: ") + formatName(targetFormat));
+    }
+    magicNumber = static_cast<uint16_t>(format);
+
+    // Blocks are compressed from mipMaps into new (pooled) buffers; the
+    // RGBA levels stay untouched for writeImage and later encodes
+    std::vector<MipMap> encodedMips;
+    {
+        MemoryStageScope memoryScope(MemoryStage::EncodedMips);
+        encodedMips.resize(mipMaps.size());
     }
 
-    // Copy mipmaps for encoding
-    std::vector<MipMap> encodedMips = mipMaps;
-
-    // Compress with DXT
-    if (format == PAAFormat::DXT5) {
-        magicNumber = 0xFF05;
-        for (auto& mip : encodedMips) {
-            compressDXT5(mip);
-        }
-    } else if (format == PAAFormat::DXT1) {
-        magicNumber = 0xFF01;
-        for (auto& mip : encodedMips) {
-            compressDXT1(mip);
+    if (progress) {
+        uint64_t totalBytes = 0;
+        for (const auto& mip : mipMaps) {
+            totalBytes += mip.data.size();
         }
+        progress->bytesTotal.store(totalBytes, std::memory_order_relaxed);
     }
 
+    // One dispatch for the whole chain; the block loops are specialised per format
+    dispatchCodec(format, [&](auto codec) {
+        for (size_t i = 0; i < mipMaps.size(); i++) {
+            compressLevel<decltype(codec)>(mipMaps[i], encodedMips[i]);
+        }
+    });
+
     // Apply LZO compression to large mipmaps (DISABLED - LZO not linked)
     /*if (encodedMips[0].width > 128) {
         if (lzo_init() != LZO_E_OK) {
@@ -243,129 +475,429 @@ void PAA::writePAA(const std::string& filename, PAAFormat targetFormat) {
         }
     }*/
 
-    // Calculate offsets tag
-    Tagg taggOffs;
-    taggOffs.signature = "GGATSFFO";
+    return encodedMips;
+}
 
-    uint32_t offset = 2; // magic number
+// A PAA laid out for output. Header fields, TAGGs and the per-mip headers
+// are packed into `headers`; mip payloads stay in their encoded buffers.
+// `segments` lists both in file order, so every sink emits the exact bytes
+// from one precomputed layout.
+struct PAA::Serialized {
+    struct Segment {
+        const uint8_t* data;
+        size_t size;
+    };
 
-    for (const auto& tagg : taggs) {
-        offset += 8 + 4 + tagg.dataLength;
+    Serialized() = default;
+    Serialized(Serialized&&) = default;
+
+    // The encoded payloads go back to the pool once written
+    ~Serialized() {
+        for (auto& mip : mips) {
+            recycleBuffer(std::move(mip.data));
+        }
     }
 
-    offset += 8 + 4 + (encodedMips.size() * 4); // OFFSTAGG itself (signature + length + data)
-    offset += 2; // palette length
+    std::vector<MipMap> mips;
+    std::vector<uint8_t> headers;
+    std::vector<Segment> segments;
+    size_t size = 0;
+};
 
-    for (const auto& mip : encodedMips) {
-        uint32_t mipOffset = offset;
-        taggOffs.data.push_back(mipOffset & 0xFF);
-        taggOffs.data.push_back((mipOffset >> 8) & 0xFF);
-        taggOffs.data.push_back((mipOffset >> 16) & 0xFF);
-        taggOffs.data.push_back((mipOffset >> 24) & 0xFF);
+namespace {
 
-        offset += 2 + 2 + 3 + mip.dataLength;
-    }
+void put16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
 
-    taggOffs.dataLength = taggOffs.data.size();
+void put24(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+}
 
-    // Write file
-    std::ofstream ofs(filename, std::ios::binary);
-    if (!ofs) {
-        throw std::runtime_error("Failed to open output file: " + filename);
-    }
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+void putTagg(std::vector<uint8_t>& out, const std::string& signature, const std::vector<uint8_t>& data) {
+    out.insert(out.end(), signature.begin(), signature.end());
+    put32(out, static_cast<uint32_t>(data.size()));
+    out.insert(out.end(), data.begin(), data.end());
+}
+
+} // namespace
 
-    writeBytes(ofs, magicNumber);
+PAA::Serialized PAA::serialize(PAAFormat targetFormat) {
+    StageScope stageScope(Stage::Encode);
+    Serialized result;
+    result.mips = encodeMipMaps(targetFormat);
+    const std::vector<MipMap>& encodedMips = result.mips;
+    MemoryStageScope memoryScope(MemoryStage::Layout);
+
+    // Offsets of every mip header, for GGATSFFO
+    uint32_t offset = 2; // magic number
+
+    // A GGATSFFO read from an existing file is stale; it is regenerated below
+    auto isOffsetTagg = [](const Tagg& tagg) { return tagg.signature == "GGATSFFO"; };
 
     for (const auto& tagg : taggs) {
-        writeString(ofs, tagg.signature);
-        writeBytes(ofs, tagg.dataLength);
-        writeBytes(ofs, tagg.data);
+        if (!isOffsetTagg(tagg)) {
+            offset += 8 + 4 + static_cast<uint32_t>(tagg.data.size());
+        }
     }
 
-    writeString(ofs, taggOffs.signature);
-    writeBytes(ofs, taggOffs.dataLength);
-    writeBytes(ofs, taggOffs.data);
+    offset += 8 + 4 + static_cast<uint32_t>(encodedMips.size() * 4); // OFFSTAGG itself
+    offset += 2 + static_cast<uint32_t>(palette.data.size());
 
-    writeBytes(ofs, palette.dataLength);
+    std::vector<uint8_t> offsets;
+    for (const auto& mip : encodedMips) {
+        put32(offsets, offset);
+        offset += 2 + 2 + 3 + static_cast<uint32_t>(mip.data.size());
+    }
+
+    std::vector<uint8_t>& headers = result.headers;
+    headers.reserve(offsets.size() + 64 + 7 * encodedMips.size() + 4);
+
+    put16(headers, magicNumber);
+    for (const auto& tagg : taggs) {
+        if (!isOffsetTagg(tagg)) {
+            putTagg(headers, tagg.signature, tagg.data);
+        }
+    }
+    putTagg(headers, "GGATSFFO", offsets);
+    put16(headers, static_cast<uint16_t>(palette.data.size()));
+    headers.insert(headers.end(), palette.data.begin(), palette.data.end());
+    size_t prefixSize = headers.size();
 
     for (const auto& mip : encodedMips) {
         uint16_t width = mip.width;
         if (mip.lzoCompressed) {
             width |= 0x8000;
         }
-        writeBytes(ofs, width);
-        writeBytes(ofs, mip.height);
-        writeBytesAsArmaUShort(ofs, mip.dataLength);
-        writeBytes(ofs, mip.data);
+        put16(headers, width);
+        put16(headers, mip.height);
+        put24(headers, static_cast<uint32_t>(mip.data.size()));
+    }
+
+    // Terminator: a zero-sized mip
+    put16(headers, 0);
+    put16(headers, 0);
+
+    // Headers are complete, so pointers into them are stable from here on
+    const uint8_t* mipHeader = headers.data() + prefixSize;
+    result.segments.push_back({headers.data(), prefixSize});
+    for (const auto& mip : encodedMips) {
+        result.segments.push_back({mipHeader, 7});
+        result.segments.push_back({mip.data.data(), mip.data.size()});
+        mipHeader += 7;
     }
+    result.segments.push_back({mipHeader, 4});
+
+    for (const auto& segment : result.segments) {
+        result.size += segment.size;
+    }
+    return result;
+}
 
-    writeBytes<uint16_t>(ofs, 0);
-    writeBytes<uint16_t>(ofs, 0);
+std::vector<uint8_t> PAA::encodePAA(PAAFormat targetFormat) {
+    Serialized serialized = serialize(targetFormat);
 
+    std::vector<uint8_t> out(serialized.size);
+    uint8_t* dst = out.data();
+    for (const auto& segment : serialized.segments) {
+        std::memcpy(dst, segment.data, segment.size);
+        dst += segment.size;
+    }
+    return out;
+}
+
+size_t PAA::encodePAA(uint8_t* out, size_t capacity, PAAFormat targetFormat) {
+    Serialized serialized = serialize(targetFormat);
+    if (serialized.size > capacity) {
+        return serialized.size;
+    }
+
+    uint8_t* dst = out;
+    for (const auto& segment : serialized.segments) {
+        std::memcpy(dst, segment.data, segment.size);
+        dst += segment.size;
+    }
+    return serialized.size;
+}
+
+size_t PAA::maxEncodedSize(uint32_t width, uint32_t height) {
+    // Every level as DXT5 (16 bytes per block), stored without LZO
+    size_t payload = 0;
+    size_t levels = 0;
+    for (;;) {
+        payload += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 16;
+        levels++;
+        if (width <= 1 && height <= 1) break;
+        width = std::max<uint32_t>(1, width / 2);
+        height = std::max<uint32_t>(1, height / 2);
+    }
+
+    // Magic, three 4-byte TAGGs, GGATSFFO, palette length, mip headers, terminator
+    size_t headers = 2 + 3 * (8 + 4 + 4) + (8 + 4 + 4 * levels) + 2 + 7 * levels + 4;
+    return headers + payload;
+}
+
+void PAA::writePAA(std::ostream& out, PAAFormat targetFormat) {
+    Serialized serialized = serialize(targetFormat);
+    for (const auto& segment : serialized.segments) {
+        out.write(reinterpret_cast<const char*>(segment.data), segment.size);
+    }
+}
+
+void PAA::writePAA(const std::string& filename, PAAFormat targetFormat, bool atomicReplace) {
+    Serialized serialized = serialize(targetFormat);
+
+    StageScope stageScope(Stage::Write);
+
+    // Readers only ever see the old file or the complete new one
+    std::string target = atomicReplace ? temporaryPathFor(filename) : filename;
+
+#ifdef _WIN32
+    std::ofstream ofs(target, std::ios::binary);
+    bool ok = static_cast<bool>(ofs);
+    for (const auto& segment : serialized.segments) {
+        if (!ok) break;
+        ok = static_cast<bool>(ofs.write(reinterpret_cast<const char*>(segment.data), segment.size));
+    }
     ofs.close();
+    ok = ok && static_cast<bool>(ofs);
+#else
+    // One gather write straight from the encoded mip buffers
+    int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+
+    std::vector<iovec> iov;
+    iov.reserve(serialized.segments.size());
+    for (const auto& segment : serialized.segments) {
+        iov.push_back({const_cast<uint8_t*>(segment.data), segment.size});
+    }
+
+    bool ok = true;
+    size_t next = 0;
+    while (next < iov.size()) {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t written = writev(fd, &iov[next], count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+
+        // Skip what was written; a short write leaves a partial segment
+        size_t remaining = static_cast<size_t>(written);
+        while (next < iov.size() && remaining >= iov[next].iov_len) {
+            remaining -= iov[next].iov_len;
+            next++;
+        }
+        if (remaining > 0) {
+            iov[next].iov_base = static_cast<uint8_t*>(iov[next].iov_base) + remaining;
+            iov[next].iov_len -= remaining;
+        }
+    }
+    ok = (close(fd) == 0) && ok;
+#endif
+
+    if (!ok) {
+        std::remove(target.c_str());
+        throw std::runtime_error("Failed to write output file: " + filename);
+    }
+
+    if (atomicReplace) {
+        replaceFile(target, filename);
+    }
 }
 
-void PAA::compressDXT1(MipMap& mipmap) {
-    size_t compressedSize = mipmap.dataLength / 8;
-    std::vector<uint8_t> compressed(compressedSize);
+void PAA::repack(const RepackOptions& options) {
+    if (mipsDecoded) {
+        throw std::runtime_error("repack needs a PAA read with readPAA(false)");
+    }
+    if (options.dropMips >= mipMaps.size()) {
+        throw std::runtime_error("Cannot drop " + std::to_string(options.dropMips) + " of " +
+                                 std::to_string(mipMaps.size()) + " mipmaps");
+    }
 
-    squish::CompressImage(
-        mipmap.data.data(),
-        mipmap.width,
-        mipmap.height,
-        compressed.data(),
-        squish::kDxt1
-    );
+    mipMaps.erase(mipMaps.begin(), mipMaps.begin() + options.dropMips);
 
-    mipmap.data = compressed;
-    mipmap.dataLength = compressedSize;
+    for (auto& mip : mipMaps) {
+        if (options.lzo == LZOMode::Decompress && mip.lzoCompressed) {
+            decompressLZO(mip);
+        } else if (options.lzo == LZOMode::Compress && !mip.lzoCompressed && mip.width > 128) {
+            compressLZO(mip);
+        }
+    }
+
+    // GGATSFFO is always regenerated from the final layout
+    taggs.erase(std::remove_if(taggs.begin(), taggs.end(), [&](const Tagg& tagg) {
+        return tagg.signature == "GGATSFFO" ||
+               std::find(options.removeTaggs.begin(), options.removeTaggs.end(), tagg.signature) !=
+                   options.removeTaggs.end();
+    }), taggs.end());
+
+    for (const auto& tagg : options.setTaggs) {
+        auto existing = std::find_if(taggs.begin(), taggs.end(),
+                                     [&](const Tagg& t) { return t.signature == tagg.signature; });
+        if (existing != taggs.end()) {
+            *existing = tagg;
+        } else {
+            taggs.push_back(tagg);
+        }
+    }
+
+    hasTransparency = std::any_of(taggs.begin(), taggs.end(),
+                                  [](const Tagg& tagg) { return tagg.signature == "GGATGALF"; });
 }
 
-void PAA::compressDXT5(MipMap& mipmap) {
-    size_t compressedSize = mipmap.dataLength / 4;
-    std::vector<uint8_t> compressed(compressedSize);
+int PAA::tierFlags() const {
+    switch (encoderTier) {
+        case EncoderTier::Fast: return squish::kColourRangeFit;
+        case EncoderTier::Best: return squish::kColourIterativeClusterFit;
+        default: return squish::kColourClusterFit;
+    }
+}
 
-    squish::CompressImage(
-        mipmap.data.data(),
-        mipmap.width,
-        mipmap.height,
-        compressed.data(),
-        squish::kDxt5
-    );
+AlphaKind PAA::classifyAlpha() const {
+    const auto& data = mipMaps[0].data;
+    AlphaKind kind = AlphaKind::Opaque;
 
-    mipmap.data = compressed;
-    mipmap.dataLength = compressedSize;
+    for (size_t i = 3; i < data.size(); i += 4) {
+        if (data[i] == 0) {
+            kind = AlphaKind::Binary;
+        } else if (data[i] != 255) {
+            return AlphaKind::Full;
+        }
+    }
+    return kind;
 }
 
-void PAA::decompressDXT1(MipMap& mipmap) {
-    size_t uncompressedSize = mipmap.dataLength * 8;
-    std::vector<uint8_t> uncompressed(uncompressedSize);
+AutoEncodeDecision PAA::chooseEncoding(const AutoEncodeSettings& settings) {
+    if (mipMaps.empty()) {
+        throw std::runtime_error("No image loaded");
+    }
+    if (mipMaps.size() <= 1) {
+        calculateMipmapsAndTaggs();
+    }
 
-    squish::DecompressImage(
-        uncompressed.data(),
-        mipmap.width,
-        mipmap.height,
-        mipmap.data.data(),
-        squish::kDxt1
-    );
+    StageScope stageScope(Stage::Encode);
+    AutoEncodeDecision decision;
+    decision.alpha = classifyAlpha();
 
-    mipmap.data = uncompressed;
-    mipmap.dataLength = uncompressedSize;
+    // Cheapest first: DXT1 is half the size of DXT5 and handles 1-bit alpha
+    std::vector<PAAFormat> formats;
+    if (decision.alpha != AlphaKind::Full) formats.push_back(PAAFormat::DXT1);
+    if (decision.alpha != AlphaKind::Opaque) formats.push_back(PAAFormat::DXT5);
+
+    const EncoderTier tiers[] = { EncoderTier::Fast, EncoderTier::Balanced, EncoderTier::Best };
+
+    // Trial-encode the first mip <= 512px; it has the same content
+    // statistics as the top level at a fraction of the encode cost
+    size_t sampleLevel = 0;
+    while (sampleLevel + 1 < mipMaps.size() &&
+           std::max(mipMaps[sampleLevel].width, mipMaps[sampleLevel].height) > 512) {
+        sampleLevel++;
+    }
+    const MipMap& sample = mipMaps[sampleLevel];
+
+    // Trials must not show up in the caller's progress accounting
+    ConversionProgress* savedProgress = progress;
+    progress = nullptr;
+
+    bool found = false;
+    for (PAAFormat candidate : formats) {
+        dispatchCodec(candidate, [&](auto codec) {
+            using Codec = decltype(codec);
+            for (EncoderTier tier : tiers) {
+                encoderTier = tier;
+
+                MipMap trial;
+                compressLevel<Codec>(sample, trial);
+                decompressLevel<Codec>(trial);
+
+                QualityMetrics quality = measureQuality(
+                    sample.data.data(), trial.data.data(), sample.width, sample.height,
+                    decision.alpha != AlphaKind::Opaque, settings.minSSIM > 0.0);
+
+                bool meets = quality.psnr >= settings.minPSNR &&
+                             (settings.minSSIM <= 0.0 || quality.ssim >= settings.minSSIM);
+
+                // Keep the best result seen in case nothing meets the target
+                if (meets || decision.format == PAAFormat::UNKNOWN || quality.psnr > decision.quality.psnr) {
+                    decision.format = candidate;
+                    decision.tier = tier;
+                    decision.quality = quality;
+                    decision.metTarget = meets;
+                }
+                recycleBuffer(std::move(trial.data));
+
+                if (meets) {
+                    found = true;
+                    break;
+                }
+            }
+        });
+        if (found) break;
+    }
+
+    progress = savedProgress;
+    encoderTier = decision.tier;
+    return decision;
 }
 
-void PAA::decompressDXT5(MipMap& mipmap) {
-    size_t uncompressedSize = mipmap.dataLength * 4;
-    std::vector<uint8_t> uncompressed(uncompressedSize);
+template <typename Codec>
+void PAA::compressLevel(const MipMap& source, MipMap& encoded) {
+    encoded.width = source.width;
+    encoded.height = source.height;
+    encoded.lzoCompressed = false;
+
+    const uint32_t blocksHigh = (source.height + Codec::blockSize - 1) / Codec::blockSize;
+    const size_t blockRowBytes = levelBytes<Codec>(source.width, 1);
+    const size_t rowPitch = static_cast<size_t>(source.width) * 4;
+    const int fitFlags = tierFlags();
+
+    MemoryStageScope memoryScope(MemoryStage::Squish);
+    std::vector<uint8_t> compressed = acquireBuffer(levelBytes<Codec>(source.width, source.height));
+
+    // One block row (4 pixel rows) at a time so a cancel request is
+    // honoured quickly even on 4096x4096 inputs
+    for (uint32_t by = 0; by < blocksHigh; by++) {
+        if (progress && progress->cancelled.load(std::memory_order_relaxed)) {
+            throw ConversionCancelled();
+        }
+
+        encodeBlockRow<Codec>(source.data.data(), source.width, source.height, by, fitFlags,
+                              compressed.data() + by * blockRowBytes);
 
-    squish::DecompressImage(
-        uncompressed.data(),
-        mipmap.width,
-        mipmap.height,
-        mipmap.data.data(),
-        squish::kDxt5
-    );
+        if (progress) {
+            const uint32_t rows = std::min<uint32_t>(Codec::blockSize, source.height - by * Codec::blockSize);
+            progress->bytesProcessed.fetch_add(rows * rowPitch, std::memory_order_relaxed);
+        }
+    }
+
+    encoded.dataLength = compressed.size();
+    encoded.data = std::move(compressed);
+}
+
+template <typename Codec>
+void PAA::decompressLevel(MipMap& mipmap) const {
+    if (mipmap.data.size() < levelBytes<Codec>(mipmap.width, mipmap.height)) {
+        throw std::runtime_error("Corrupt PAA: mipmap payload shorter than its dimensions need");
+    }
+
+    size_t uncompressedSize = static_cast<size_t>(mipmap.width) * mipmap.height * 4;
+    std::vector<uint8_t> uncompressed = acquireBuffer(uncompressedSize);
+    decodeLevel<Codec>(mipmap.data.data(), mipmap.width, mipmap.height, uncompressed.data());
+    recycleBuffer(std::move(mipmap.data));
 
-    mipmap.data = uncompressed;
+    mipmap.data = std::move(uncompressed);
     mipmap.dataLength = uncompressedSize;
 }
 
@@ -374,7 +906,7 @@ void PAA::compressLZO(MipMap& mipmap) {
     throw std::runtime_error("LZO compression not available in this build");
 }
 
-void PAA::decompressLZO(MipMap& mipmap) {
+void PAA::decompressLZO(MipMap& mipmap) const {
     // LZO DISABLED - not linked
     throw std::runtime_error("LZO decompression not available in this build");
 }
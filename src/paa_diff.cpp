@@ -0,0 +1,416 @@
+#include "paa_diff.h"
+#include "paa_codec.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARMA3_HAVE_SSE2 1
+#endif
+
+namespace arma3 {
+
+namespace {
+
+// Blocks compared per memcmp before looking at single blocks. Unchanged
+// data, the common case, runs at libc memcmp speed
+constexpr size_t ScanStride = 256;
+
+bool readWholeFile(const std::string& path, std::vector<uint8_t>& data, std::string& error) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        error = "Failed to open " + path;
+        return false;
+    }
+    data.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        error = "Failed to read " + path;
+        return false;
+    }
+    return true;
+}
+
+template <size_t BlockBytes>
+bool blockEqual(const uint8_t* a, const uint8_t* b) {
+    if constexpr (BlockBytes == 16) {
+#ifdef ARMA3_HAVE_SSE2
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#else
+        return std::memcmp(a, b, 16) == 0;
+#endif
+    } else if constexpr (BlockBytes == 8) {
+        uint64_t wa;
+        uint64_t wb;
+        std::memcpy(&wa, a, 8);
+        std::memcpy(&wb, b, 8);
+        return wa == wb;
+    } else {
+        return std::memcmp(a, b, BlockBytes) == 0;
+    }
+}
+
+// Call onChanged(index) for every block whose bytes differ
+template <size_t BlockBytes, typename Fn>
+void scanChangedBlocks(const uint8_t* a, const uint8_t* b, size_t blocks, Fn&& onChanged) {
+    for (size_t first = 0; first < blocks; first += ScanStride) {
+        const size_t count = std::min(ScanStride, blocks - first);
+        const size_t offset = first * BlockBytes;
+        if (std::memcmp(a + offset, b + offset, count * BlockBytes) == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const size_t at = offset + i * BlockBytes;
+            if (!blockEqual<BlockBytes>(a + at, b + at)) {
+                onChanged(first + i);
+            }
+        }
+    }
+}
+
+// Group touching changed blocks (4-connected) into pixel bounding boxes
+std::vector<DiffRegion> findRegions(std::vector<uint8_t>& changed, uint32_t blocksWide, uint32_t blocksHigh,
+                                    uint32_t width, uint32_t height, uint32_t blockSize, size_t maxRegions) {
+    std::vector<DiffRegion> regions;
+    std::vector<uint32_t> stack;
+
+    for (uint32_t start = 0; start < changed.size(); start++) {
+        if (!changed[start]) continue;
+
+        uint32_t minX = blocksWide, minY = blocksHigh, maxX = 0, maxY = 0;
+        uint64_t count = 0;
+        changed[start] = 0;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            const uint32_t index = stack.back();
+            stack.pop_back();
+            const uint32_t bx = index % blocksWide;
+            const uint32_t by = index / blocksWide;
+            minX = std::min(minX, bx);
+            minY = std::min(minY, by);
+            maxX = std::max(maxX, bx);
+            maxY = std::max(maxY, by);
+            count++;
+
+            auto visit = [&](uint32_t next) {
+                if (changed[next]) {
+                    changed[next] = 0;
+                    stack.push_back(next);
+                }
+            };
+            if (bx > 0) visit(index - 1);
+            if (bx + 1 < blocksWide) visit(index + 1);
+            if (by > 0) visit(index - blocksWide);
+            if (by + 1 < blocksHigh) visit(index + blocksWide);
+        }
+
+        DiffRegion region;
+        region.x = minX * blockSize;
+        region.y = minY * blockSize;
+        region.width = std::min((maxX + 1) * blockSize, width) - region.x;
+        region.height = std::min((maxY + 1) * blockSize, height) - region.y;
+        region.blocks = count;
+        regions.push_back(region);
+    }
+
+    std::stable_sort(regions.begin(), regions.end(),
+                     [](const DiffRegion& l, const DiffRegion& r) { return l.blocks > r.blocks; });
+    if (regions.size() > maxRegions) {
+        regions.resize(maxRegions);
+    }
+    return regions;
+}
+
+// Compare one pair of same-sized levels. With the same codec only blocks
+// whose bytes differ are decoded; across codecs every block is
+template <typename CodecA, typename CodecB>
+void diffLevel(const PAAHeaderView::Level& a, const PAAHeaderView::Level& b,
+               const DiffOptions& options, MipDiff& mip) {
+    static_assert(CodecA::blockSize == CodecB::blockSize, "Codecs must share a block size");
+    constexpr uint32_t B = CodecA::blockSize;
+    const uint32_t width = a.width;
+    const uint32_t height = a.height;
+    const uint32_t blocksWide = (width + B - 1) / B;
+    const uint32_t blocksHigh = (height + B - 1) / B;
+
+    if (a.dataLength < levelBytes<CodecA>(width, height) || b.dataLength < levelBytes<CodecB>(width, height)) {
+        throw std::runtime_error("Corrupt PAA: " + std::to_string(width) + "x" + std::to_string(height) +
+                                 " mipmap is shorter than its block data");
+    }
+
+    mip.blocks = static_cast<uint64_t>(blocksWide) * blocksHigh;
+    std::vector<uint8_t> changedMap;
+    uint64_t squaredError = 0;
+    uint8_t pixelsA[B * B * 4];
+    uint8_t pixelsB[B * B * 4];
+
+    auto compareBlock = [&](size_t index) {
+        mip.changedBlocks++;
+        if (changedMap.empty()) {
+            changedMap.resize(mip.blocks);
+        }
+        if (!options.decodeBlocks) {
+            changedMap[index] = 1;
+            return;
+        }
+
+        CodecA::decodeBlock(a.data + index * CodecA::bytesPerBlock, pixelsA);
+        CodecB::decodeBlock(b.data + index * CodecB::bytesPerBlock, pixelsB);
+
+        // Padding pixels of edge blocks are not part of the image
+        const uint32_t x0 = static_cast<uint32_t>(index % blocksWide) * B;
+        const uint32_t y0 = static_cast<uint32_t>(index / blocksWide) * B;
+        const uint32_t columns = std::min(B, width - x0);
+        const uint32_t rows = std::min(B, height - y0);
+        uint32_t blockMax = 0;
+        for (uint32_t py = 0; py < rows; py++) {
+            const uint8_t* pa = pixelsA + py * B * 4;
+            const uint8_t* pb = pixelsB + py * B * 4;
+            for (uint32_t i = 0; i < columns * 4; i++) {
+                const int32_t delta = static_cast<int32_t>(pa[i]) - pb[i];
+                squaredError += static_cast<uint64_t>(delta * delta);
+                blockMax = std::max<uint32_t>(blockMax, static_cast<uint32_t>(std::abs(delta)));
+            }
+        }
+        if (blockMax > 0) {
+            mip.visibleBlocks++;
+            mip.maxDelta = std::max(mip.maxDelta, blockMax);
+            changedMap[index] = 1;
+        }
+    };
+
+    if constexpr (std::is_same_v<CodecA, CodecB>) {
+        scanChangedBlocks<CodecA::bytesPerBlock>(a.data, b.data, mip.blocks, compareBlock);
+    } else {
+        for (size_t i = 0; i < mip.blocks; i++) {
+            compareBlock(i);
+        }
+    }
+
+    mip.payloadChanged = mip.changedBlocks > 0;
+    if (squaredError > 0) {
+        const double mse = static_cast<double>(squaredError) / (static_cast<double>(width) * height * 4);
+        mip.psnr = 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+    if (!changedMap.empty()) {
+        mip.regions = findRegions(changedMap, blocksWide, blocksHigh, width, height, B, options.maxRegions);
+    }
+}
+
+void diffLevelBytes(const PAAHeaderView::Level& a, const PAAHeaderView::Level& b, MipDiff& mip) {
+    mip.bytesOnly = true;
+    mip.payloadChanged = a.dataLength != b.dataLength || std::memcmp(a.data, b.data, a.dataLength) != 0;
+}
+
+std::string hexBytes(const uint8_t* data, uint32_t length) {
+    constexpr uint32_t Shown = 16;
+    std::ostringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (uint32_t i = 0; i < std::min(length, Shown); i++) {
+        ss << std::setw(2) << static_cast<int>(data[i]);
+    }
+    if (length > Shown) {
+        ss << "... (" << std::dec << length << " bytes)";
+    }
+    return ss.str();
+}
+
+void diffHeaders(const PAAHeaderView& a, const PAAHeaderView& b, std::vector<std::string>& changes) {
+    if (a.format != b.format) {
+        changes.push_back(std::string("format ") + formatName(a.format) + " -> " + formatName(b.format));
+    }
+
+    // GGATSFFO holds file offsets; it changes whenever anything before a mip does
+    auto find = [](const PAAHeaderView& view, const std::string& signature) -> const PAAHeaderView::TaggEntry* {
+        for (const auto& tagg : view.taggs) {
+            if (tagg.signature == signature) return &tagg;
+        }
+        return nullptr;
+    };
+    for (const auto& tagg : a.taggs) {
+        if (tagg.signature == "GGATSFFO") continue;
+        const auto* other = find(b, tagg.signature);
+        if (!other) {
+            changes.push_back("TAGG " + tagg.signature + " removed");
+        } else if (other->dataLength != tagg.dataLength ||
+                   std::memcmp(other->data, tagg.data, tagg.dataLength) != 0) {
+            changes.push_back("TAGG " + tagg.signature + " " + hexBytes(tagg.data, tagg.dataLength) +
+                              " -> " + hexBytes(other->data, other->dataLength));
+        }
+    }
+    for (const auto& tagg : b.taggs) {
+        if (tagg.signature == "GGATSFFO" || find(a, tagg.signature)) continue;
+        changes.push_back("TAGG " + tagg.signature + " added " + hexBytes(tagg.data, tagg.dataLength));
+    }
+
+    if (a.paletteLength != b.paletteLength) {
+        changes.push_back("palette " + std::to_string(a.paletteLength) + " -> " +
+                          std::to_string(b.paletteLength) + " bytes");
+    }
+}
+
+bool isSignificant(const PAADiff& diff, const DiffOptions& options) {
+    if (!diff.error.empty() || !diff.headerChanges.empty()) {
+        return true;
+    }
+    for (const auto& mip : diff.mips) {
+        if (mip.levelA < 0 || mip.levelB < 0) return true;
+        if (!mip.payloadChanged) continue;
+        if (mip.bytesOnly || !options.decodeBlocks) return true;
+        if (mip.visibleBlocks > 0 && mip.psnr < options.minPSNR) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+PAADiff diffPAAFiles(const std::string& pathA, const std::string& pathB, const DiffOptions& options) {
+    std::vector<uint8_t> a;
+    std::vector<uint8_t> b;
+    std::string error;
+    if (!readWholeFile(pathA, a, error) || !readWholeFile(pathB, b, error)) {
+        PAADiff diff;
+        diff.pathA = pathA;
+        diff.pathB = pathB;
+        diff.error = error;
+        diff.significant = true;
+        return diff;
+    }
+
+    PAADiff diff = diffPAABuffers(a.data(), a.size(), b.data(), b.size(), options);
+    diff.pathA = pathA;
+    diff.pathB = pathB;
+    return diff;
+}
+
+PAADiff diffPAABuffers(const uint8_t* a, size_t sizeA, const uint8_t* b, size_t sizeB,
+                       const DiffOptions& options) {
+    PAADiff diff;
+    try {
+        if (sizeA == sizeB && std::memcmp(a, b, sizeA) == 0) {
+            // Nothing to pair up, but the input must still be a PAA
+            diff.identical = true;
+            diff.formatA = diff.formatB = parsePAAHeaders(a, sizeA).format;
+            return diff;
+        }
+
+        const PAAHeaderView viewA = parsePAAHeaders(a, sizeA);
+        const PAAHeaderView viewB = parsePAAHeaders(b, sizeB);
+        diff.formatA = viewA.format;
+        diff.formatB = viewB.format;
+        diffHeaders(viewA, viewB, diff.headerChanges);
+
+        const bool decodable = hasCodec(viewA.format) && hasCodec(viewB.format);
+        std::vector<bool> pairedB(viewB.mips.size(), false);
+
+        for (size_t i = 0; i < viewA.mips.size(); i++) {
+            const auto& levelA = viewA.mips[i];
+            MipDiff mip;
+            mip.width = levelA.width;
+            mip.height = levelA.height;
+            mip.levelA = static_cast<int>(i);
+
+            for (size_t j = 0; j < viewB.mips.size(); j++) {
+                if (!pairedB[j] && viewB.mips[j].width == levelA.width && viewB.mips[j].height == levelA.height) {
+                    pairedB[j] = true;
+                    mip.levelB = static_cast<int>(j);
+                    break;
+                }
+            }
+
+            if (mip.levelB >= 0) {
+                const auto& levelB = viewB.mips[mip.levelB];
+                if (!decodable || levelA.lzoCompressed || levelB.lzoCompressed) {
+                    diffLevelBytes(levelA, levelB, mip);
+                } else {
+                    // One instantiation per format pair; nothing inside branches on it
+                    dispatchCodec(viewA.format, [&](auto codecA) {
+                        dispatchCodec(viewB.format, [&](auto codecB) {
+                            diffLevel<decltype(codecA), decltype(codecB)>(levelA, levelB, options, mip);
+                        });
+                    });
+                }
+            }
+            diff.mips.push_back(std::move(mip));
+        }
+
+        for (size_t j = 0; j < viewB.mips.size(); j++) {
+            if (pairedB[j]) continue;
+            MipDiff mip;
+            mip.width = viewB.mips[j].width;
+            mip.height = viewB.mips[j].height;
+            mip.levelB = static_cast<int>(j);
+            diff.mips.push_back(std::move(mip));
+        }
+    } catch (const std::exception& e) {
+        diff = PAADiff{};
+        diff.error = e.what();
+    }
+
+    diff.significant = isSignificant(diff, options);
+    return diff;
+}
+
+std::string paaDiffToJSON(const PAADiff& diff) {
+    using utils::jsonEscape;
+
+    std::ostringstream ss;
+    ss << "{\"a\":\"" << jsonEscape(diff.pathA) << "\""
+       << ",\"b\":\"" << jsonEscape(diff.pathB) << "\""
+       << ",\"identical\":" << (diff.identical ? "true" : "false")
+       << ",\"significant\":" << (diff.significant ? "true" : "false");
+    if (!diff.error.empty()) {
+        ss << ",\"error\":\"" << jsonEscape(diff.error) << "\"}";
+        return ss.str();
+    }
+    ss << ",\"format_a\":\"" << formatName(diff.formatA) << "\""
+       << ",\"format_b\":\"" << formatName(diff.formatB) << "\""
+       << ",\"header_changes\":[";
+    for (size_t i = 0; i < diff.headerChanges.size(); i++) {
+        ss << (i ? "," : "") << "\"" << jsonEscape(diff.headerChanges[i]) << "\"";
+    }
+    ss << "],\"mips\":[";
+    for (size_t i = 0; i < diff.mips.size(); i++) {
+        const MipDiff& mip = diff.mips[i];
+        ss << (i ? "," : "")
+           << "{\"width\":" << mip.width
+           << ",\"height\":" << mip.height
+           << ",\"level_a\":" << mip.levelA
+           << ",\"level_b\":" << mip.levelB
+           << ",\"bytes_only\":" << (mip.bytesOnly ? "true" : "false")
+           << ",\"payload_changed\":" << (mip.payloadChanged ? "true" : "false")
+           << ",\"blocks\":" << mip.blocks
+           << ",\"changed_blocks\":" << mip.changedBlocks
+           << ",\"visible_blocks\":" << mip.visibleBlocks
+           << ",\"max_delta\":" << mip.maxDelta
+           << ",\"psnr\":";
+        // JSON has no infinity
+        if (std::isinf(mip.psnr)) {
+            ss << "null";
+        } else {
+            ss << mip.psnr;
+        }
+        ss << ",\"regions\":[";
+        for (size_t r = 0; r < mip.regions.size(); r++) {
+            const DiffRegion& region = mip.regions[r];
+            ss << (r ? "," : "")
+               << "{\"x\":" << region.x << ",\"y\":" << region.y
+               << ",\"width\":" << region.width << ",\"height\":" << region.height
+               << ",\"blocks\":" << region.blocks << "}";
+        }
+        ss << "]}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+} // namespace arma3
\ No newline at end of file
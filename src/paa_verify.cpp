@@ -0,0 +1,281 @@
+#include "paa_verify.h"
+#include "paa_codec.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace arma3 {
+
+namespace {
+
+// Random-access view over either a file or a memory buffer
+class ByteSource {
+public:
+    ByteSource(const uint8_t* data, size_t size) : memory(data), length(size) {}
+
+    explicit ByteSource(const std::string& path) : file(path, std::ios::binary) {
+        if (file) {
+            file.seekg(0, std::ios::end);
+            length = static_cast<uint64_t>(file.tellg());
+            file.seekg(0);
+        }
+    }
+
+    bool isOpen() const { return memory != nullptr || file.is_open(); }
+    uint64_t size() const { return length; }
+
+    bool read(uint64_t offset, void* dst, size_t count) {
+        if (offset + count > length) {
+            return false;
+        }
+        if (memory) {
+            std::memcpy(dst, memory + offset, count);
+            return true;
+        }
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(static_cast<char*>(dst), count);
+        return static_cast<size_t>(file.gcount()) == count;
+    }
+
+private:
+    const uint8_t* memory = nullptr;
+    std::ifstream file;
+    uint64_t length = 0;
+};
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le24(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+// Only formats with a codec have a fixed size; the others are LZSS-packed
+uint64_t expectedPayload(PAAFormat format, uint32_t width, uint32_t height) {
+    return dispatchCodec(format, [&](auto codec) {
+        return static_cast<uint64_t>(levelBytes<decltype(codec)>(width, height));
+    });
+}
+
+std::string describe(const char* what, uint64_t offset) {
+    std::ostringstream ss;
+    ss << what << " at offset " << offset;
+    return ss.str();
+}
+
+VerifyReport verifySource(ByteSource& source, VerifyReport report, const VerifyOptions& options) {
+    report.fileSize = source.size();
+    uint8_t buf[16];
+    uint64_t pos = 0;
+
+    if (!source.read(0, buf, 2)) {
+        report.fail("File too short for PAA magic");
+        return report;
+    }
+    report.format = formatFromMagic(le16(buf));
+    if (report.format == PAAFormat::UNKNOWN) {
+        report.fail("Invalid PAA magic number: " + std::to_string(le16(buf)));
+        return report;
+    }
+    pos = 2;
+
+    // TAGGs
+    std::vector<uint32_t> offsetTable;
+    bool sawOffsets = false;
+    for (;;) {
+        // Anything not starting with "GGAT" is the palette length, which
+        // need not have a zero low byte
+        if (!source.read(pos, buf, 4) || std::memcmp(buf, "GGAT", 4) != 0) {
+            break;
+        }
+        if (!source.read(pos, buf, 12)) {
+            report.fail(describe("Truncated TAGG header", pos));
+            return report;
+        }
+
+        std::string signature(reinterpret_cast<char*>(buf), 8);
+        uint32_t length = le32(buf + 8);
+        if (pos + 12 + length > source.size()) {
+            report.fail(describe(("TAGG " + signature + " length runs past end of file").c_str(), pos));
+            return report;
+        }
+
+        if (signature == "GGATSFFO") {
+            if (length % 4 != 0 || length > 16 * 4) {
+                report.fail(describe("GGATSFFO has invalid length", pos));
+                return report;
+            }
+            std::vector<uint8_t> table(length);
+            source.read(pos + 12, table.data(), length);
+            for (uint32_t i = 0; i < length; i += 4) {
+                offsetTable.push_back(le32(table.data() + i));
+            }
+            sawOffsets = true;
+        } else if ((signature == "GGATCGVA" || signature == "GGATCXAM" || signature == "GGATGALF") && length != 4) {
+            report.warnings.push_back("TAGG " + signature + " has unexpected length " + std::to_string(length));
+        }
+
+        pos += 12 + length;
+    }
+
+    // Palette
+    if (!source.read(pos, buf, 2)) {
+        report.fail(describe("Truncated palette length", pos));
+        return report;
+    }
+    uint16_t paletteLength = le16(buf);
+    pos += 2;
+    if (pos + paletteLength > source.size()) {
+        report.fail(describe("Palette runs past end of file", pos));
+        return report;
+    }
+    pos += paletteLength;
+
+    // Mipmaps
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> pixels;
+    uint32_t prevWidth = 0;
+    uint32_t prevHeight = 0;
+
+    for (;;) {
+        if (!source.read(pos, buf, 2)) {
+            report.fail(describe("Missing mipmap terminator", pos));
+            return report;
+        }
+        if (le16(buf) == 0) {
+            break;
+        }
+        if (!source.read(pos, buf, 7)) {
+            report.fail(describe("Truncated mipmap header", pos));
+            return report;
+        }
+
+        const size_t level = report.mipCount;
+        const uint64_t headerPos = pos;
+        uint16_t rawWidth = le16(buf);
+        bool lzo = (rawWidth & 0x8000) != 0;
+        uint32_t width = rawWidth & 0x7FFF;
+        uint32_t height = le16(buf + 2);
+        uint32_t length = le24(buf + 4);
+        std::string where = "mip " + std::to_string(level);
+
+        if (level < offsetTable.size() && offsetTable[level] != headerPos) {
+            report.fail(where + ": GGATSFFO offset " + std::to_string(offsetTable[level]) +
+                        " does not match actual position " + std::to_string(headerPos));
+        } else if (sawOffsets && level >= offsetTable.size()) {
+            report.fail(where + ": missing from GGATSFFO");
+        }
+
+        if (width == 0 || height == 0) {
+            report.fail(where + ": zero dimension");
+            return report;
+        }
+        if (level == 0) {
+            report.width = width;
+            report.height = height;
+        } else if (width != std::max(1u, prevWidth / 2) || height != std::max(1u, prevHeight / 2)) {
+            report.fail(where + ": " + std::to_string(width) + "x" + std::to_string(height) +
+                        " does not follow " + std::to_string(prevWidth) + "x" + std::to_string(prevHeight));
+        }
+
+        const bool sized = hasCodec(report.format);
+        uint64_t expected = sized ? expectedPayload(report.format, width, height) : 0;
+        if (!sized) {
+            if (level == 0) {
+                report.warnings.push_back(std::string(formatName(report.format)) +
+                                          " mip payloads are LZSS-packed; only checked to fit the file");
+            }
+        } else if (!lzo && length != expected) {
+            report.fail(where + ": payload is " + std::to_string(length) +
+                        " bytes, expected " + std::to_string(expected));
+        } else if (lzo && length > expected + expected / 16 + 64 + 3) {
+            report.fail(where + ": LZO payload larger than worst case");
+        }
+
+        pos += 7;
+        if (pos + length > source.size()) {
+            report.fail(where + ": payload runs past end of file");
+            return report;
+        }
+
+        if (options.decodeLevels && sized && !lzo && length == expected) {
+            payload.resize(length);
+            if (!source.read(pos, payload.data(), length)) {
+                report.fail(where + ": read error");
+                return report;
+            }
+            pixels.resize(static_cast<size_t>(width) * height * 4);
+            decodeDXTBlocks(report.format, payload.data(), payload.size(), width, height, pixels.data());
+        } else if (options.decodeLevels && lzo) {
+            report.warnings.push_back(where + ": LZO payload not decoded (LZO not available in this build)");
+        }
+
+        pos += length;
+        prevWidth = width;
+        prevHeight = height;
+        report.mipCount++;
+    }
+
+    if (report.mipCount == 0) {
+        report.fail("No mipmaps");
+    }
+    for (size_t i = report.mipCount; i < offsetTable.size(); i++) {
+        if (offsetTable[i] != 0) {
+            report.fail("GGATSFFO entry " + std::to_string(i) + " points past the last mip");
+            break;
+        }
+    }
+
+    // Terminator is two zero uint16 (width + height); some writers pad a little more
+    if (pos + 4 > source.size()) {
+        report.warnings.push_back("Short mipmap terminator");
+    } else if (source.size() - pos > 6) {
+        report.warnings.push_back(std::to_string(source.size() - pos - 4) + " trailing bytes after terminator");
+    }
+
+    return report;
+}
+
+} // namespace
+
+VerifyReport verifyPAAFile(const std::string& path, const VerifyOptions& options) {
+    VerifyReport report;
+    report.path = path;
+
+    ByteSource source(path);
+    if (!source.isOpen()) {
+        report.fail("Cannot open file");
+        return report;
+    }
+    return verifySource(source, report, options);
+}
+
+VerifyReport verifyPAABuffer(const uint8_t* data, size_t size, const VerifyOptions& options) {
+    ByteSource source(data, size);
+    return verifySource(source, VerifyReport{}, options);
+}
+
+std::string verifyReportToJSON(const VerifyReport& report) {
+    using utils::jsonEscape;
+
+    std::ostringstream ss;
+    ss << "{\"path\":\"" << jsonEscape(report.path) << "\""
+       << ",\"ok\":" << (report.ok ? "true" : "false")
+       << ",\"format\":\"" << formatName(report.format) << "\""
+       << ",\"size\":" << report.fileSize
+       << ",\"width\":" << report.width
+       << ",\"height\":" << report.height
+       << ",\"mips\":" << report.mipCount
+       << ",\"errors\":[";
+    for (size_t i = 0; i < report.errors.size(); i++) {
+        ss << (i ? "," : "") << "\"" << jsonEscape(report.errors[i]) << "\"";
+    }
+    ss << "],\"warnings\":[";
+    for (size_t i = 0; i < report.warnings.size(); i++) {
+        ss << (i ? "," : "") << "\"" << jsonEscape(report.warnings[i]) << "\"";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+} // namespace arma3
\ No newline at end of file
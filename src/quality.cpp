@@ -0,0 +1,140 @@
+#include "quality.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARMA3_HAVE_SSE2 1
+#endif
+
+namespace arma3 {
+
+uint64_t sumSquaredError(const uint8_t* a, const uint8_t* b, size_t pixels, bool includeAlpha) {
+    const uint32_t channelMask = includeAlpha ? 0xFFFFFFFFu : 0x00FFFFFFu;
+    uint64_t total = 0;
+    size_t i = 0;
+
+#ifdef ARMA3_HAVE_SSE2
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(channelMask));
+    const __m128i alphaBits = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    // RGB lanes dropped for transparent reference texels (none without alpha)
+    const __m128i hiddenBits = _mm_set1_epi32(includeAlpha ? 0x00FFFFFF : 0);
+    const __m128i zero = _mm_setzero_si128();
+
+    // 4 pixels per step; madd yields 32-bit partial sums that are flushed
+    // to 64 bits well before they can overflow (255^2 * 2 * 4096 < 2^31)
+    while (i + 4 <= pixels) {
+        __m128i acc = _mm_setzero_si128();
+        size_t end = std::min(pixels, i + 4 * 4096) & ~size_t(3);
+
+        for (; i < end; i += 4) {
+            __m128i ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4));
+            __m128i hidden = _mm_cmpeq_epi32(_mm_and_si128(ra, alphaBits), zero);
+            __m128i keep = _mm_andnot_si128(_mm_and_si128(hidden, hiddenBits), mask);
+            __m128i va = _mm_and_si128(ra, keep);
+            __m128i vb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4)), keep);
+
+            __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(dlo, dlo));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(dhi, dhi));
+        }
+
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        total += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+    const int channels = includeAlpha ? 4 : 3;
+    for (; i < pixels; i++) {
+        const int first = includeAlpha && a[i * 4 + 3] == 0 ? 3 : 0;
+        for (int c = first; c < channels; c++) {
+            int d = int(a[i * 4 + c]) - int(b[i * 4 + c]);
+            total += uint64_t(d * d);
+        }
+    }
+
+    return total;
+}
+
+static inline float luma(const uint8_t* p) {
+    return 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+}
+
+double computeSSIM(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height,
+                   bool maskTransparent) {
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const uint32_t window = 8;
+
+    double total = 0.0;
+    uint32_t windows = 0;
+
+    for (uint32_t wy = 0; wy + window <= height; wy += window) {
+        for (uint32_t wx = 0; wx + window <= width; wx += window) {
+            double sumX = 0, sumY = 0, sumXX = 0, sumYY = 0, sumXY = 0;
+
+            for (uint32_t y = wy; y < wy + window; y++) {
+                for (uint32_t x = wx; x < wx + window; x++) {
+                    size_t idx = (static_cast<size_t>(y) * width + x) * 4;
+                    const bool hidden = maskTransparent && reference[idx + 3] == 0;
+                    double lx = hidden ? 0.0 : luma(reference + idx);
+                    double ly = hidden ? 0.0 : luma(test + idx);
+                    sumX += lx;
+                    sumY += ly;
+                    sumXX += lx * lx;
+                    sumYY += ly * ly;
+                    sumXY += lx * ly;
+                }
+            }
+
+            const double n = window * window;
+            double muX = sumX / n;
+            double muY = sumY / n;
+            double varX = sumXX / n - muX * muX;
+            double varY = sumYY / n - muY * muY;
+            double cov = sumXY / n - muX * muY;
+
+            total += ((2 * muX * muY + c1) * (2 * cov + c2)) /
+                     ((muX * muX + muY * muY + c1) * (varX + varY + c2));
+            windows++;
+        }
+    }
+
+    // Images smaller than one window are compared as a whole by PSNR only
+    return windows > 0 ? total / windows : 1.0;
+}
+
+QualityMetrics measureQuality(const uint8_t* reference, const uint8_t* test,
+                              uint32_t width, uint32_t height,
+                              bool includeAlpha, bool computeSSIMValue) {
+    QualityMetrics metrics;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    if (pixels == 0) {
+        return metrics;
+    }
+
+    // Only channels that were compared count towards the mean
+    size_t samples = pixels * (includeAlpha ? 4 : 3);
+    if (includeAlpha) {
+        for (size_t i = 0; i < pixels; i++) {
+            if (reference[i * 4 + 3] == 0) samples -= 3;
+        }
+    }
+    uint64_t sse = sumSquaredError(reference, test, pixels, includeAlpha);
+
+    metrics.mse = static_cast<double>(sse) / samples;
+    metrics.rmse = std::sqrt(metrics.mse);
+    metrics.psnr = metrics.mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / metrics.mse) : 99.0;
+    metrics.psnr = std::min(metrics.psnr, 99.0);
+
+    if (computeSSIMValue) {
+        metrics.ssim = computeSSIM(reference, test, width, height, includeAlpha);
+    }
+
+    return metrics;
+}
+
+} // namespace arma3
\ No newline at end of file
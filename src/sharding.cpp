@@ -0,0 +1,63 @@
+#include "sharding.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace arma3 {
+
+void parseShardSpec(const std::string& spec, uint32_t& index, uint32_t& count) {
+    size_t slash = spec.find('/');
+    if (slash == std::string::npos) {
+        throw std::runtime_error("Invalid shard spec (expected i/N): " + spec);
+    }
+
+    try {
+        index = static_cast<uint32_t>(std::stoul(spec.substr(0, slash)));
+        count = static_cast<uint32_t>(std::stoul(spec.substr(slash + 1)));
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("Invalid shard spec (expected i/N): " + spec);
+    }
+
+    if (count == 0 || index >= count) {
+        throw std::runtime_error("Shard index out of range: " + spec);
+    }
+}
+
+std::vector<ShardItem> selectShard(std::vector<ShardItem> items, uint32_t shardIndex, uint32_t shardCount) {
+    struct Keyed {
+        uint64_t weight;
+        uint64_t hash;
+        size_t index;
+    };
+
+    std::vector<Keyed> order;
+    order.reserve(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        order.push_back({items[i].weight, utils::hashString(items[i].path), i});
+    }
+
+    // Heaviest first gives the greedy assignment a near-optimal balance;
+    // the path itself breaks hash ties so the order is total
+    std::sort(order.begin(), order.end(), [&items](const Keyed& a, const Keyed& b) {
+        if (a.weight != b.weight) return a.weight > b.weight;
+        if (a.hash != b.hash) return a.hash < b.hash;
+        return items[a.index].path < items[b.index].path;
+    });
+
+    std::vector<uint64_t> load(shardCount, 0);
+    std::vector<ShardItem> selected;
+
+    for (const auto& key : order) {
+        uint32_t target = static_cast<uint32_t>(std::min_element(load.begin(), load.end()) - load.begin());
+        load[target] += std::max<uint64_t>(key.weight, 1);
+        if (target == shardIndex) {
+            selected.push_back(std::move(items[key.index]));
+        }
+    }
+
+    return selected;
+}
+
+} // namespace arma3
\ No newline at end of file
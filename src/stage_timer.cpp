@@ -0,0 +1,43 @@
+#include "stage_timer.h"
+
+namespace arma3 {
+
+namespace {
+
+thread_local StageRecorder* activeRecorder = nullptr;
+
+} // namespace
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Read: return "read";
+        case Stage::Decode: return "decode";
+        case Stage::Mips: return "mips";
+        case Stage::Encode: return "encode";
+        case Stage::Write: return "write";
+        default: return "unknown";
+    }
+}
+
+StageRecorder::StageRecorder(StageTimes& times) : times(&times), previous(activeRecorder) {
+    activeRecorder = this;
+}
+
+StageRecorder::~StageRecorder() {
+    activeRecorder = previous;
+}
+
+StageScope::StageScope(Stage stage) : recorder(activeRecorder), stage(stage) {
+    if (recorder) {
+        recorder->last = stage;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+StageScope::~StageScope() {
+    if (recorder) {
+        (*recorder->times)[stage] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "thread_pool.h"
+#include "cpu_topology.h"
+
+#include <algorithm>
+
+namespace arma3 {
+
+ThreadPool::ThreadPool(size_t threadCount, bool pinWorkers) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<int> cpus;
+    if (pinWorkers) {
+        cpus = CpuTopology::get().placement(threadCount);
+        pinnedWorkers = !cpus.empty();
+    }
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        int cpu = cpus.empty() ? -1 : cpus[i];
+        workers.emplace_back([this, cpu]() {
+            if (cpu >= 0) {
+                pinCurrentThread(cpu);
+            }
+            workerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    allIdle.wait(lock, [this]() { return tasks.empty() && activeTasks == 0; });
+}
+
+size_t ThreadPool::pendingTasks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            // Drain remaining work before shutting down
+            if (tasks.empty()) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            activeTasks++;
+        }
+
+        // Tasks report their own errors; never let one take down a worker
+        try {
+            task();
+        }
+        catch (...) {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeTasks--;
+            if (tasks.empty() && activeTasks == 0) {
+                allIdle.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace arma3
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "thumbnail_cache.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace arma3 {
+
+// Decodes that nobody asked for within this many frames are dropped, so a
+// fast scroll doesn't leave a long tail of off-screen work in the queue
+static const uint64_t kStaleFrames = 3;
+
+// A failed preview is decoded again after this many frames (~2 s at 60 Hz):
+// the source may have been listed while it was still being saved
+static const uint64_t kRetryFrames = 120;
+
+// GL internal format a PAA payload can be uploaded as without decoding.
+// DXT2/DXT4 are premultiplied and go through the CPU decoder instead
+static GLenum compressedGLFormat(PAAFormat format) {
+    switch (format) {
+        case PAAFormat::DXT1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case PAAFormat::DXT3: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case PAAFormat::DXT5: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        default: return 0;
+    }
+}
+
+static bool hasS3TC() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ThumbnailCache::ThumbnailCache(size_t byteBudget, uint32_t thumbnailSize, size_t decodeThreads)
+    : budget(byteBudget), thumbSize(thumbnailSize), s3tcSupported(hasS3TC()), pool(decodeThreads) {}
+
+ThumbnailCache::~ThumbnailCache() {
+    {
+        // Make every queued decode bail out early
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.clear();
+    }
+    pool.wait();
+
+    for (auto& entry : lru) {
+        if (entry.thumbnail.texture != 0) {
+            glDeleteTextures(1, &entry.thumbnail.texture);
+        }
+    }
+}
+
+std::string ThumbnailCache::makeKey(const std::string& path, ThumbnailSource source) {
+    return (source == ThumbnailSource::PAA ? "paa:" : "img:") + path;
+}
+
+const Thumbnail* ThumbnailCache::request(const std::string& path, ThumbnailSource source) {
+    std::string key = makeKey(path, source);
+    uint64_t now = frame.load(std::memory_order_relaxed);
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        if (it->second->thumbnail.texture != 0 || now < it->second->retryFrame) {
+            lru.splice(lru.begin(), lru, it->second);
+            return &it->second->thumbnail;
+        }
+        usedBytes -= it->second->bytes;
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto pendingIt = pending.find(key);
+        if (pendingIt != pending.end()) {
+            pendingIt->second.lastFrame = now;
+            return nullptr;
+        }
+
+        ticket = nextTicket++;
+        pending[key] = PendingRequest{ticket, now};
+    }
+
+    pool.submit([this, key, path, source, ticket]() { decode(key, path, source, ticket); });
+    return nullptr;
+}
+
+void ThumbnailCache::invalidate(const std::string& path, ThumbnailSource source) {
+    std::string key = makeKey(path, source);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.erase(key);
+    }
+
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+
+    if (it->second->thumbnail.texture != 0) {
+        glDeleteTextures(1, &it->second->thumbnail.texture);
+    }
+    usedBytes -= it->second->bytes;
+    lru.erase(it->second);
+    entries.erase(it);
+}
+
+void ThumbnailCache::decode(const std::string& key, const std::string& path,
+                            ThumbnailSource source, uint64_t ticket) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(key);
+        if (it == pending.end() || it->second.ticket != ticket) {
+            return;
+        }
+        if (frame.load(std::memory_order_relaxed) - it->second.lastFrame > kStaleFrames) {
+            pending.erase(it);
+            return;
+        }
+    }
+
+    Decoded result;
+    result.key = key;
+    result.ticket = ticket;
+
+    try {
+        if (source == ThumbnailSource::PAA) {
+            PAA paa(path);
+            paa.readPAA(false);
+            size_t base = paa.findMipForSize(thumbSize);
+            const auto& mips = paa.getMipMaps();
+
+            if (s3tcSupported && compressedGLFormat(paa.getFormat()) != 0) {
+                // Hand the DXT blocks to the GPU as-is, from the smallest
+                // adequate level down, so minification still has a full chain
+                result.compressedFormat = paa.getFormat();
+                result.compressedMips.assign(mips.begin() + base, mips.end());
+            } else {
+                // CPU fallback: decode only the level the thumbnail needs
+                result.image = ImageLoader::downscale(paa.decodeMipMap(base), thumbSize);
+            }
+        } else {
+            result.image = ImageLoader::loadThumbnail(path, thumbSize);
+        }
+        result.ok = true;
+    }
+    catch (const std::exception&) {
+        result.ok = false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.push_back(std::move(result));
+}
+
+void ThumbnailCache::processUploads(size_t maxUploads) {
+    frame.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t count = std::min(maxUploads, finished.size());
+        ready.assign(std::make_move_iterator(finished.begin()),
+                     std::make_move_iterator(finished.begin() + count));
+        finished.erase(finished.begin(), finished.begin() + count);
+
+        // Keep only results that still match an outstanding request
+        auto keep = std::remove_if(ready.begin(), ready.end(), [this](const Decoded& d) {
+            auto it = pending.find(d.key);
+            if (it == pending.end() || it->second.ticket != d.ticket) {
+                return true;
+            }
+            pending.erase(it);
+            return false;
+        });
+        ready.erase(keep, ready.end());
+    }
+
+    for (auto& decoded : ready) {
+        Thumbnail thumbnail;
+        size_t bytes = 0;
+
+        if (decoded.ok && decoded.compressedFormat != PAAFormat::UNKNOWN) {
+            bytes = uploadCompressed(thumbnail, decoded.compressedFormat, decoded.compressedMips);
+        } else if (decoded.ok) {
+            uploadRGBA(thumbnail, decoded.image);
+            bytes = decoded.image.data.size();
+        }
+
+        insert(decoded.key, thumbnail, bytes);
+    }
+
+    evictToBudget();
+}
+
+void ThumbnailCache::uploadRGBA(Thumbnail& thumbnail, const ImageData& image) {
+    thumbnail.width = image.width;
+    thumbnail.height = image.height;
+
+    glGenTextures(1, &thumbnail.texture);
+    glBindTexture(GL_TEXTURE_2D, thumbnail.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, image.data.data());
+}
+
+size_t ThumbnailCache::uploadCompressed(Thumbnail& thumbnail, PAAFormat format,
+                                        const std::vector<MipMap>& mips) {
+    const GLenum glFormat = compressedGLFormat(format);
+
+    // Stop at the first level whose payload doesn't match its dimensions;
+    // GL would reject it and leave the texture incomplete
+    size_t levels = 0;
+    for (const auto& mip : mips) {
+        size_t expected = static_cast<size_t>((mip.width + 3) / 4) * ((mip.height + 3) / 4) * dxtBlockBytes(format);
+        if (mip.lzoCompressed || mip.data.size() != expected) break;
+        levels++;
+    }
+    if (levels == 0) {
+        return 0;
+    }
+
+    thumbnail.width = mips[0].width;
+    thumbnail.height = mips[0].height;
+
+    glGenTextures(1, &thumbnail.texture);
+    glBindTexture(GL_TEXTURE_2D, thumbnail.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    size_t bytes = 0;
+    for (size_t level = 0; level < levels; level++) {
+        const MipMap& mip = mips[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), glFormat,
+                               mip.width, mip.height, 0,
+                               static_cast<GLsizei>(mip.data.size()), mip.data.data());
+        bytes += mip.data.size();
+    }
+
+    return bytes;
+}
+
+void ThumbnailCache::insert(const std::string& key, const Thumbnail& thumbnail, size_t bytes) {
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        if (it->second->thumbnail.texture != 0) {
+            glDeleteTextures(1, &it->second->thumbnail.texture);
+        }
+        usedBytes -= it->second->bytes;
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+
+    uint64_t retryFrame = thumbnail.texture == 0 ? frame.load(std::memory_order_relaxed) + kRetryFrames : 0;
+    lru.push_front(Entry{key, thumbnail, bytes, retryFrame});
+    entries[key] = lru.begin();
+    usedBytes += bytes;
+}
+
+void ThumbnailCache::evictToBudget() {
+    // Never evict the most recent entry, even if it alone exceeds the budget
+    while (usedBytes > budget && lru.size() > 1) {
+        Entry& victim = lru.back();
+        if (victim.thumbnail.texture != 0) {
+            glDeleteTextures(1, &victim.thumbnail.texture);
+        }
+        usedBytes -= victim.bytes;
+        entries.erase(victim.key);
+        lru.pop_back();
+    }
+}
+
+} // namespace arma3
\ No newline at end of file